@@ -3,10 +3,10 @@ include(CTest)
 if(BUILD_TESTING)
 	include_directories(../include)
 
-	foreach(x array false null number object parser string true wikipedia)
+	foreach(x allocator arena array buffer false handler null number object parser pool projection reader string true wikipedia)
 		add_executable(test-${x}
 			../test/${x}.c ../test/expect.c ../test/expect.h)
-		target_link_libraries(test-${x} QxJson)
+		target_link_libraries(test-${x} QxJson ${CMAKE_THREAD_LIBS_INIT})
 		add_test(
 			NAME ${x}
 			WORKING_DIRECTORY ${CMAKE_CURRENT_SOURCE_DIR}
@@ -0,0 +1,48 @@
+/**
+ * @file qx.json.allocator.h
+ * @brief Header file of the QxJsonAllocator interface.
+ * @author Romain DEOUX
+ */
+
+#ifndef _H_QX_JSON_ALLOCATOR
+#define _H_QX_JSON_ALLOCATOR
+
+#include <stddef.h>
+
+#include "qx.json.macro.h"
+
+/**
+ * @brief Memory allocation functions used by the library.
+ *
+ * Each function receives the @c ptr member as its first argument.
+ * An allocator must outlive every parser and every value allocated from it.
+ */
+typedef struct QxJsonAllocator
+{
+	/** Allocate @c size bytes, like malloc(). */
+	void *(*allocate)(void *ptr, size_t size);
+	/** Resize a block to @c size bytes, like realloc(). */
+	void *(*reallocate)(void *ptr, void *block, size_t size);
+	/** Free a block, like free(). Never called with a null block. */
+	void (*deallocate)(void *ptr, void *block);
+	/** A custom pointer forwarded to the functions. */
+	void *ptr;
+} QxJsonAllocator;
+
+/**
+ * @brief Set the allocator used by default.
+ * @param allocator The allocator, or NULL to restore the standard one.
+ *
+ * It is used by QxJsonParser_new() and by the QxJsonValue_*New() functions.
+ * Values keep track of their allocator: changing it does not affect existing
+ * values.
+ */
+QX_API void QxJson_setAllocator(QxJsonAllocator const *allocator);
+
+/**
+ * @brief Get the allocator used by default.
+ * @return The allocator.
+ */
+QX_API QxJsonAllocator const *QxJson_allocator(void);
+
+#endif /* _H_QX_JSON_ALLOCATOR */
@@ -8,7 +8,10 @@
 #define _H_QX_JSON_PARSER
 
 #include <stddef.h>
+#include <stdint.h>
 
+#include "qx.json.allocator.h"
+#include "qx.json.projection.h"
 #include "qx.json.value.h"
 
 /**
@@ -22,12 +25,207 @@ typedef struct QxJsonParser QxJsonParser;
  */
 QX_API QxJsonParser *QxJsonParser_new(void);
 
+/**
+ * @brief Create a new parser using a custom allocator.
+ * @param allocator The allocator, or NULL for the default one.
+ * @return A parser instance.
+ *
+ * The parser itself, its buffers and every value it creates are allocated
+ * using @c allocator.
+ */
+QX_API QxJsonParser *QxJsonParser_newWithAllocator(QxJsonAllocator const *allocator);
+
 /**
  * @brief Destroy a parser.
  * @param self The instance to be destroyed.
  */
 QX_API void QxJsonParser_release(QxJsonParser *self);
 
+/**
+ * @brief Make a parser ready for a new document.
+ * @param self The parser instance.
+ *
+ * The document being parsed, if any, is dropped, for instance after an
+ * error. The settings and the allocated buffers are kept, so a parser can
+ * be reused from one document to the other instead of being recreated.
+ */
+QX_API void QxJsonParser_reset(QxJsonParser *self);
+
+/**
+ * @brief Take a parser from the pool of the calling thread.
+ * @return A parser with the default settings, or NULL on memory failure.
+ *
+ * A new parser is created when the pool is empty. Giving it back with
+ * QxJsonParser_recycle() keeps its warmed-up buffers for the next request
+ * of the thread.
+ */
+QX_API QxJsonParser *QxJsonParser_acquire(void);
+
+/**
+ * @brief Give a parser back to the pool of the calling thread.
+ * @param self A parser from QxJsonParser_acquire(), or NULL.
+ *
+ * The parser is reset and its default settings are restored. It is released
+ * when the pool is full, or when it does not use the default allocator.
+ * Pooled parsers are released when the thread exits.
+ */
+QX_API void QxJsonParser_recycle(QxJsonParser *self);
+
+/**
+ * @def QX_JSON_PARSER_ARENA
+ * @brief Parser flag: allocate each document from an arena.
+ *
+ * Every value of a parsed array or object document is allocated from
+ * bump-pointer chunks owned by the root value. Releasing the root frees the
+ * whole document at once, whatever its number of values.
+ *
+ * The reference counters of the other values of such a document are ignored:
+ * none of them may outlive the root. Heap values inserted later into an arena
+ * container are kept alive until the root is released.
+ */
+#define QX_JSON_PARSER_ARENA 0x1
+
+/**
+ * @def QX_JSON_PARSER_LAZY_NUMBERS
+ * @brief Parser flag: decode the numbers of a document on first use.
+ *
+ * Numbers keep their validated source text, available through
+ * QxJsonValue_numberText(). It is decoded by the first call to a number
+ * accessor, then cached. A lazy number beyond the range of double decodes to
+ * an infinity instead of failing the parsing.
+ *
+ * Caching writes to the number without synchronization: the numbers of such a
+ * document must not be read from several threads at once.
+ */
+#define QX_JSON_PARSER_LAZY_NUMBERS 0x2
+
+/**
+ * @def QX_JSON_PARSER_UTF8_STRINGS
+ * @brief Parser flag: store the strings and keys of a document as UTF-8.
+ *
+ * Mostly ASCII text then takes a byte per character instead of a wchar_t,
+ * available through QxJsonValue_stringUtf8(). QxJsonValue_stringValue()
+ * decodes such a string on first use and keeps the result. Strings holding
+ * escaped lone surrogates, which UTF-8 cannot encode, stay wide.
+ *
+ * The decoded result is attached to the string without any lock: the strings
+ * of such a document must not be passed to QxJsonValue_stringValue() from
+ * several threads at once.
+ */
+#define QX_JSON_PARSER_UTF8_STRINGS 0x4
+
+/**
+ * @brief Set the options of a parser.
+ * @param self  The parser instance.
+ * @param flags A combination of QX_JSON_PARSER_* flags.
+ * @return 0 on success. Flags cannot be changed while parsing a document.
+ */
+QX_API int QxJsonParser_setFlags(QxJsonParser *self, unsigned int flags);
+
+/**
+ * @brief Set the capacity of the token buffer kept between documents.
+ * @param self     The parser instance.
+ * @param capacity Count of wide characters, 512 by default.
+ * @return 0 on success. It cannot be changed while parsing a document.
+ *
+ * The buffer holding the text of the string and number tokens starts with
+ * this capacity and grows geometrically for longer tokens. A buffer grown
+ * beyond the capacity is shrunk back to it at the end of the next document
+ * using less than a quarter of it, so that an outlier document does not pin
+ * memory. Setting the capacity shrinks the buffer at once. With 0, the buffer
+ * is freed between documents.
+ */
+QX_API int QxJsonParser_setBufferCapacity(QxJsonParser *self, size_t capacity);
+
+/**
+ * @def QX_JSON_MAX_DEPTH
+ * @brief Default maximum nesting depth of the parsed documents.
+ *
+ * It is also the limit of QxJson_parseBuffer().
+ */
+#define QX_JSON_MAX_DEPTH 1024
+
+/**
+ * @brief Limit the nesting depth of the documents.
+ * @param self  The parser instance.
+ * @param depth Count of nested arrays and objects, or 0 for no limit.
+ * @return 0 on success. It cannot be changed while parsing a document.
+ *
+ * A document opening one container too many fails at once, before anything
+ * is allocated for it. The default is QX_JSON_MAX_DEPTH: values are released
+ * recursively, so much deeper documents could overflow the call stack.
+ */
+QX_API int QxJsonParser_setMaxDepth(QxJsonParser *self, size_t depth);
+
+/**
+ * @brief Only build the selected parts of the documents.
+ * @param self       The parser instance.
+ * @param projection The selected paths, or NULL to build whole documents. It
+ *                   must outlive its use by the parser.
+ * @return 0 on success. The projection cannot be changed while parsing a
+ * document.
+ *
+ * Values out of the selected paths are skipped while tokenizing, as with
+ * QxJsonParser_skip(). The containers leading to the selected paths are
+ * built, even if they end up empty. It has no effect with a custom handler.
+ */
+QX_API int QxJsonParser_setProjection(QxJsonParser *self,
+	QxJsonProjection const *projection);
+
+/**
+ * @brief Callbacks receiving the parsing events.
+ *
+ * Each callback gets the @c ptr given to QxJsonParser_setHandler() and returns
+ * 0 to continue. Any other value aborts the parsing and is returned by the
+ * feeding function. Strings are only valid during the call; they are
+ * nul-terminated but may contain nul characters, hence their size.
+ *
+ * Integers are given to @c number as doubles when their callback is NULL.
+ */
+typedef struct QxJsonHandler
+{
+	int (*beginArray)(void *ptr);
+	int (*endArray)(void *ptr);
+	int (*beginObject)(void *ptr);
+	int (*endObject)(void *ptr);
+	int (*key)(void *ptr, wchar_t const *data, size_t size);
+	int (*string)(void *ptr, wchar_t const *data, size_t size);
+	int (*number)(void *ptr, double value);
+	int (*boolean)(void *ptr, int value);
+	int (*null)(void *ptr);
+	/** Numbers without fraction nor exponent fitting 64 bits, may be NULL */
+	int (*integer)(void *ptr, int64_t value);
+	/** Integers beyond INT64_MAX, may be NULL */
+	int (*unsignedInteger)(void *ptr, uint64_t value);
+} QxJsonHandler;
+
+/**
+ * @brief Stream the parsing events instead of building values.
+ * @param self    The parser instance.
+ * @param handler The callbacks, or NULL to build QxJsonValue documents again.
+ * @param ptr     User data given to the callbacks.
+ * @return 0 on success. The handler cannot be changed while parsing a document.
+ *
+ * No value is allocated while a handler is set: QxJsonParser_end() then only
+ * checks that the document is complete and its @c value argument may be NULL.
+ */
+QX_API int QxJsonParser_setHandler(QxJsonParser *self,
+	QxJsonHandler const *handler, void *ptr);
+
+/**
+ * @brief Skip a value without parsing it.
+ * @param self The parser instance.
+ * @return 0 on success.
+ *
+ * To be called from a QxJsonHandler callback. From @c key, the value of the
+ * member is skipped and raises no event. From @c beginArray or @c beginObject,
+ * the rest of the container is skipped and only its end event is raised.
+ *
+ * Skipped characters are only scanned to balance brackets and strings: they
+ * are neither buffered nor validated.
+ */
+QX_API int QxJsonParser_skip(QxJsonParser *self);
+
 /**
  * @brief Feed the parser with a new token.
  * @param self The parser instance.
@@ -38,12 +236,44 @@ QX_API void QxJsonParser_release(QxJsonParser *self);
 QX_API int QxJsonParser_feed(QxJsonParser *self,
 	wchar_t const *data, size_t size);
 
+/**
+ * @brief Feed the parser with UTF-8 encoded bytes.
+ * @param self The parser instance.
+ * @param data UTF-8 chunck.
+ * @param size Size of the UTF-8 chunck in bytes.
+ * @return 0 on success.
+ *
+ * The bytes are decoded by small chunks while being tokenized, plain ASCII
+ * runs of strings being copied directly. A multi-byte sequence may be split
+ * across several chunks.
+ * Overlong encodings, surrogates and out of range code points are rejected.
+ */
+QX_API int QxJsonParser_feedUtf8(QxJsonParser *self,
+	char const *data, size_t size);
+
 /**
  * @brief Ends the stream parsing.
  * @param self The parser instance.
  * @param value The parsed value if any.
- * @return 0 on success.
+ * @return 0 on success. The parser is then ready for the next document.
  */
 QX_API int QxJsonParser_end(QxJsonParser *self, QxJsonValue **value);
 
+/**
+ * @brief Parse a whole UTF-8 document at once.
+ * @param data  The document.
+ * @param size  Size of the document in bytes, below 4 GiB.
+ * @param flags A combination of QX_JSON_PARSER_ARENA,
+ *              QX_JSON_PARSER_LAZY_NUMBERS and QX_JSON_PARSER_UTF8_STRINGS.
+ * @param value The parsed value.
+ * @return 0 on success.
+ *
+ * Instead of feeding a state machine, a first pass indexes the structural
+ * characters of the buffer by blocks of 64 bytes, using vector instructions
+ * when available. A second pass builds the values from this index. The
+ * document is validated as with a QxJsonParser.
+ */
+QX_API int QxJson_parseBuffer(char const *data, size_t size, unsigned int flags,
+	QxJsonValue **value);
+
 #endif /* _H_QX_JSON_PARSER */
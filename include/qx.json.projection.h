@@ -0,0 +1,48 @@
+/**
+ * @file qx.json.projection.h
+ * @brief Header file of the QxJsonProjection class.
+ * @author Romain DEOUX
+ */
+
+#ifndef _H_QX_JSON_PROJECTION
+#define _H_QX_JSON_PROJECTION
+
+#include <stddef.h>
+
+#include "qx.json.macro.h"
+
+/**
+ * @brief A set of JSON Pointers (RFC 6901) selecting parts of a document.
+ *
+ * Besides the standard syntax, a @c * reference token matches any member of
+ * an object and any item of an array. A value matched by both a named token
+ * and a wildcard is selected by the paths of both.
+ */
+typedef struct QxJsonProjection QxJsonProjection;
+
+/**
+ * @brief Create an empty projection.
+ * @return A projection instance.
+ */
+QX_API QxJsonProjection *QxJsonProjection_new(void);
+
+/**
+ * @brief Destroy a projection.
+ * @param self The instance to be destroyed.
+ */
+QX_API void QxJsonProjection_release(QxJsonProjection *self);
+
+/**
+ * @brief Select a path.
+ * @param self    The projection instance.
+ * @param pointer The JSON Pointer, such as @c /items/0/price.
+ * @param size    Size of the pointer.
+ * @return 0 on success. Malformed pointers are rejected.
+ *
+ * The whole value referenced by the pointer is selected. The empty pointer
+ * selects the whole document.
+ */
+QX_API int QxJsonProjection_add(QxJsonProjection *self,
+	wchar_t const *pointer, size_t size);
+
+#endif /* _H_QX_JSON_PROJECTION */
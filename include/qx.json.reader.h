@@ -0,0 +1,119 @@
+/**
+ * @file qx.json.reader.h
+ * @brief Header file of the QxJsonReader class.
+ * @author Romain DEOUX
+ */
+
+#ifndef _H_QX_JSON_READER
+#define _H_QX_JSON_READER
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "qx.json.macro.h"
+
+/**
+ * @brief The unique identifier of a reading event.
+ */
+typedef enum QxJsonEvent
+{
+	QxJsonEventError,
+	QxJsonEventEnd,
+	QxJsonEventBeginArray,
+	QxJsonEventEndArray,
+	QxJsonEventBeginObject,
+	QxJsonEventEndObject,
+	QxJsonEventKey,
+	QxJsonEventString,
+	QxJsonEventNumber,
+	QxJsonEventFalse,
+	QxJsonEventTrue,
+	QxJsonEventNull
+} QxJsonEvent;
+
+/**
+ * @brief The QxJsonReader class.
+ *
+ * A reader walks a document one event at a time, without creating any value.
+ */
+typedef struct QxJsonReader QxJsonReader;
+
+/**
+ * @brief Create a reader over a unicode document.
+ * @param data The document, which must outlive the reader.
+ * @param size Size of the document.
+ * @return A reader instance.
+ */
+QX_API QxJsonReader *QxJsonReader_new(wchar_t const *data, size_t size);
+
+/**
+ * @brief Create a reader over an UTF-8 document.
+ * @param data The document, which must outlive the reader.
+ * @param size Size of the document in bytes.
+ * @return A reader instance.
+ */
+QX_API QxJsonReader *QxJsonReader_newUtf8(char const *data, size_t size);
+
+/**
+ * @brief Destroy a reader.
+ * @param self The instance to be destroyed.
+ */
+QX_API void QxJsonReader_release(QxJsonReader *self);
+
+/**
+ * @brief Read the next event.
+ * @param self The reader instance.
+ * @return The event. QxJsonEventEnd and QxJsonEventError are returned again
+ * by the following calls.
+ */
+QX_API QxJsonEvent QxJsonReader_next(QxJsonReader *self);
+
+/**
+ * @brief Get the text of the current key or string event.
+ * @param self The reader instance.
+ * @param size Where to store the size of the text, may be NULL.
+ * @return The nul-terminated text, valid until the next call to the reader,
+ * or NULL if the current event has no text.
+ */
+QX_API wchar_t const *QxJsonReader_string(QxJsonReader const *self, size_t *size);
+
+/**
+ * @brief Get the value of the current number event.
+ * @param self The reader instance.
+ * @return The number, or 0 if the current event is not a number.
+ */
+QX_API double QxJsonReader_number(QxJsonReader const *self);
+
+/**
+ * @brief Get the value of the current number event as a signed integer.
+ * @param self  The reader instance.
+ * @param value Where to store the integer.
+ * @return 0 on success. Fails if the number is not an integer fitting 64 bits.
+ */
+QX_API int QxJsonReader_int64(QxJsonReader const *self, int64_t *value);
+
+/**
+ * @brief Get the value of the current number event as an unsigned integer.
+ * @param self  The reader instance.
+ * @param value Where to store the integer.
+ * @return 0 on success. Fails if the number is not an integer fitting 64 bits.
+ */
+QX_API int QxJsonReader_uint64(QxJsonReader const *self, uint64_t *value);
+
+/**
+ * @brief Skip the value started by the current event.
+ * @param self The reader instance.
+ * @return 0 on success.
+ *
+ * After QxJsonEventBeginArray or QxJsonEventBeginObject, the rest of the
+ * container is skipped: the current event becomes its end. After
+ * QxJsonEventKey, the value of the key is skipped. Other events are left as
+ * is.
+ *
+ * The input is read ahead by slices: the containers of a skipped value that
+ * lie beyond the input already read are scanned without being parsed nor
+ * validated.
+ */
+QX_API int QxJsonReader_skip(QxJsonReader *self);
+
+#endif /* _H_QX_JSON_READER */
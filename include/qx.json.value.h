@@ -8,6 +8,7 @@
 #define _H_QX_JSON_VALUE
 
 #include <stddef.h>
+#include <stdint.h>
 
 #include "qx.json.macro.h"
 
@@ -33,6 +34,9 @@ typedef struct QxJsonValue QxJsonValue;
 /**
  * @brief Increment the reference counter of a value.
  * @param self The value.
+ *
+ * It has no effect on the shared null, true and false values, nor on the
+ * small integers.
  */
 QX_API void QxJsonValue_retains(QxJsonValue *self);
 
@@ -40,7 +44,8 @@ QX_API void QxJsonValue_retains(QxJsonValue *self);
  * @brief Decrement the reference counter of a value.
  * @param self The value.
  *
- * When the reference counter reach zero, the value is freed.
+ * When the reference counter reach zero, the value is freed. The shared
+ * null, true and false values and the small integers are never freed.
  */
 QX_API void QxJsonValue_release(QxJsonValue *self);
 
@@ -180,16 +185,21 @@ QX_API int QxJsonValue_arrayEach(QxJsonValue *self,
 /* False */
 
 /**
- * @brief Create a new false value.
+ * @brief Get the false value.
  * @return A JavaScript false value.
+ *
+ * The same immortal instance is returned by every call: it is not allocated
+ * and may be shared freely between threads.
  */
 QX_API QxJsonValue *QxJsonValue_falseNew(void);
 
 /* Null */
 
 /**
- * @brief Create a new null value.
+ * @brief Get the null value.
  * @return A JavaScript null value.
+ *
+ * A shared immortal instance, as with QxJsonValue_falseNew().
  */
 QX_API QxJsonValue *QxJsonValue_nullNew(void);
 
@@ -202,13 +212,112 @@ QX_API QxJsonValue *QxJsonValue_nullNew(void);
  */
 QX_API QxJsonValue *QxJsonValue_numberNew(double value);
 
+/**
+ * @brief Create a new number value holding an exact signed integer.
+ * @param value The integer.
+ * @return A JavaScript number value.
+ *
+ * Small integers, within +/-2^62 (+/-2^30 on 32 bits platforms), are encoded
+ * in the returned handle itself: nothing is allocated for them. Parsers
+ * create their integers this way, unless the numbers are lazy.
+ */
+QX_API QxJsonValue *QxJsonValue_numberNewInt64(int64_t value);
+
+/**
+ * @brief Create a new number value holding an exact unsigned integer.
+ * @param value The integer.
+ * @return A JavaScript number value.
+ */
+QX_API QxJsonValue *QxJsonValue_numberNewUint64(uint64_t value);
+
 /**
  * @brief Get the number value.
  * @brief self A value where type equals QxJsonValueTypeNumber.
- * @return A double valid value or NaN if the value have not the right type.
+ * @return A double valid value or NaN if the value have not the right type,
+ * or if a lazy number cannot be decoded for lack of memory.
+ *
+ * Integers beyond 2^53 are rounded. Use QxJsonValue_numberInt64() or
+ * QxJsonValue_numberUint64() to get them exactly.
  */
 QX_API double QxJsonValue_numberValue(QxJsonValue const *self);
 
+/**
+ * @brief Get the source text of a number.
+ * @param self A value where type equals QxJsonValueTypeNumber.
+ * @param size Where to store the size of the text, may be NULL.
+ * @return The nul-terminated text the number was parsed from, or NULL if it
+ * was not parsed with QX_JSON_PARSER_LAZY_NUMBERS.
+ *
+ * The text keeps every digit, beyond the precision of a double.
+ */
+QX_API wchar_t const *QxJsonValue_numberText(QxJsonValue const *self, size_t *size);
+
+/**
+ * @brief Test that a number holds an exact integer.
+ * @param self The value.
+ * @return 1 if the number was created or parsed as an integer.
+ */
+QX_API int QxJsonValue_numberIsInteger(QxJsonValue const *self);
+
+/**
+ * @brief Get the number value as a signed integer.
+ * @param self  A value where type equals QxJsonValueTypeNumber.
+ * @param value Where to store the integer.
+ * @return 0 on success. Fails if the number is not an integer within range.
+ *
+ * A number held as a double only converts below 2^53 in magnitude, where
+ * integral doubles are exact.
+ */
+QX_API int QxJsonValue_numberInt64(QxJsonValue const *self, int64_t *value);
+
+/**
+ * @brief Get the number value as an unsigned integer.
+ * @param self  A value where type equals QxJsonValueTypeNumber.
+ * @param value Where to store the integer.
+ * @return 0 on success. Fails if the number is not an integer within range.
+ *
+ * A number held as a double only converts below 2^53 in magnitude, where
+ * integral doubles are exact.
+ */
+QX_API int QxJsonValue_numberUint64(QxJsonValue const *self, uint64_t *value);
+
+/* Key */
+
+/**
+ * @brief A reusable object key with a cached hash.
+ *
+ * Declare it once, for instance with static storage, and use it with
+ * QxJsonValue_objectGetKey() as many times as needed without any allocation:
+ * @code
+ * static QxJsonKey typeKey = QX_JSON_KEY(L"type");
+ * QxJsonValue_objectGetKey(object, &typeKey, &value);
+ * @endcode
+ * The fields are public only to allow static initialization.
+ */
+typedef struct QxJsonKey
+{
+	wchar_t const *data; /**< The wide characters of the key */
+	size_t size;         /**< The number of wide characters */
+	size_t hash;         /**< Cached hash, valid when @c hashed is not 0 */
+	int hashed;          /**< 0 until the hash has been computed */
+} QxJsonKey;
+
+/**
+ * @def QX_JSON_KEY
+ * @brief Static initializer of a key handle from a wide string literal.
+ */
+#define QX_JSON_KEY(literal) \
+	{ (literal), sizeof(literal) / sizeof(wchar_t) - 1, 0, 0 }
+
+/**
+ * @brief Compute and cache the hash of a key handle.
+ * @param self The key handle.
+ *
+ * This is done implicitly on first lookup. Call it explicitly before sharing
+ * a key handle between threads.
+ */
+QX_API void QxJsonKey_prepare(QxJsonKey *self);
+
 /* Object */
 
 /**
@@ -245,6 +354,40 @@ QX_API int QxJsonValue_objectUnset(QxJsonValue *self, QxJsonValue *key);
 QX_API int QxJsonValue_objectGet(QxJsonValue *self,
 	QxJsonValue const *key, QxJsonValue **value);
 
+/**
+ * @brief Get a value from an object, using a raw wide key.
+ * @param self  The object.
+ * @param data  The wide characters of the key.
+ * @param size  The number of wide characters of the key.
+ * @param value The output value.
+ * @return 0 on success.
+ *
+ * Unlike QxJsonValue_objectGet(), no temporary string value is needed.
+ */
+QX_API int QxJsonValue_objectGetData(QxJsonValue *self,
+	wchar_t const *data, size_t size, QxJsonValue **value);
+
+/**
+ * @brief Get a value from an object, using an UTF-8 encoded key.
+ * @param self  The object.
+ * @param data  The UTF-8 bytes of the key.
+ * @param size  The number of bytes of the key.
+ * @param value The output value.
+ * @return 0 on success. Invalid UTF-8 keys are never found.
+ */
+QX_API int QxJsonValue_objectGetUtf8(QxJsonValue *self,
+	char const *data, size_t size, QxJsonValue **value);
+
+/**
+ * @brief Get a value from an object, using a key handle.
+ * @param self  The object.
+ * @param key   The key handle. Its hash is computed on first use.
+ * @param value The output value.
+ * @return 0 on success.
+ */
+QX_API int QxJsonValue_objectGetKey(QxJsonValue *self, QxJsonKey *key,
+	QxJsonValue **value);
+
 /**
  * @brief Walk through an object.
  * @param self     The object.
@@ -267,19 +410,43 @@ QX_API int QxJsonValue_objectEach(QxJsonValue *self,
  */
 QX_API QxJsonValue *QxJsonValue_stringNew(wchar_t const *data, size_t size);
 
+/**
+ * @brief Create a new string value stored as UTF-8.
+ * @param data The UTF-8 bytes.
+ * @param size The number of bytes.
+ * @return A JavaScript string value, or NULL if @c data is not valid UTF-8.
+ *
+ * The size of the value is still its number of wide characters.
+ */
+QX_API QxJsonValue *QxJsonValue_stringNewUtf8(char const *data, size_t size);
+
 /**
  * @brief Get the string value.
  * @brief self A value where type equals QxJsonValueTypeString.
  * @return A pointer to the wide string data or NULL if the value have not the
  *         right type.
+ *
+ * The wide characters of a string stored as UTF-8 are decoded by the first
+ * call, then kept along with the value. NULL is returned if that fails.
  */
 QX_API wchar_t const *QxJsonValue_stringValue(QxJsonValue const *self);
 
+/**
+ * @brief Get the text of a string stored as UTF-8.
+ * @param self The string.
+ * @param size The number of bytes of the text, may be NULL.
+ * @return The nul-terminated UTF-8 text, or NULL if the value is not a string
+ *         stored as UTF-8.
+ */
+QX_API char const *QxJsonValue_stringUtf8(QxJsonValue const *self, size_t *size);
+
 /* True */
 
 /**
- * @brief Create a new true value.
+ * @brief Get the true value.
  * @return A JavaScript true value.
+ *
+ * A shared immortal instance, as with QxJsonValue_falseNew().
  */
 QX_API QxJsonValue *QxJsonValue_trueNew(void);
 
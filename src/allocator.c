@@ -0,0 +1,48 @@
+/**
+ * @file allocator.c
+ * @brief Source file of the QxJsonAllocator interface.
+ * @author Romain DEOUX
+ */
+
+#include <stdlib.h>
+
+#include "../include/qx.json.allocator.h"
+#include "qx.json.private.h"
+
+/* Private functions */
+
+static void *systemAllocate(void *ptr, size_t size)
+{
+	(void)ptr;
+	return malloc(size);
+}
+
+static void *systemReallocate(void *ptr, void *block, size_t size)
+{
+	(void)ptr;
+	return realloc(block, size);
+}
+
+static void systemDeallocate(void *ptr, void *block)
+{
+	(void)ptr;
+	free(block);
+}
+
+/* Public implementations */
+
+QxJsonAllocator const QxJsonAllocator_system = {
+	&systemAllocate, &systemReallocate, &systemDeallocate, NULL
+};
+
+static QxJsonAllocator const *defaultAllocator = &QxJsonAllocator_system;
+
+void QxJson_setAllocator(QxJsonAllocator const *allocator)
+{
+	defaultAllocator = allocator ? allocator : &QxJsonAllocator_system;
+}
+
+QxJsonAllocator const *QxJson_allocator(void)
+{
+	return defaultAllocator;
+}
@@ -0,0 +1,190 @@
+/**
+ * @file arena.c
+ * @brief Source file of the document arena.
+ * @author Romain DEOUX
+ */
+
+#include <assert.h>
+#include <string.h>
+
+#include "qx.json.private.h"
+
+/* Private structure */
+
+typedef union ArenaChunk
+{
+	struct
+	{
+		union ArenaChunk *next;
+		size_t size;
+		size_t used;
+	} header;
+	MaxAlign align;
+} ArenaChunk;
+
+struct QxJsonArena
+{
+	QxJsonAllocator const *allocator;
+	ArenaChunk *chunks; /* The current chunk first */
+	size_t chunkSize;   /* Data size of the next chunk */
+	void *last;         /* Last allocated block, may be grown in place */
+
+	/* Heap values stored into arena containers */
+	QxJsonValue **foreign;
+	size_t foreignSize;
+	size_t foreignAlloc;
+};
+
+#define ARENA_ALIGN sizeof(MaxAlign)
+#define ARENA_ROUND(size) (((size) + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1))
+#define ARENA_MIN_CHUNK 4096
+#define ARENA_MAX_CHUNK (1024 * 1024)
+#define ArenaChunk_data(chunk) ((char *)((chunk) + 1))
+
+/* Public implementations */
+
+QxJsonArena *QxJsonArena_new(QxJsonAllocator const *allocator)
+{
+	QxJsonArena *instance;
+
+	instance = (QxJsonArena *)QxJsonAllocator_alloc(allocator, sizeof(QxJsonArena));
+
+	if (instance)
+	{
+		memset(instance, 0, sizeof(QxJsonArena));
+		instance->allocator = allocator;
+		instance->chunkSize = ARENA_MIN_CHUNK;
+	}
+
+	return instance;
+}
+
+void QxJsonArena_delete(QxJsonArena *self)
+{
+	ArenaChunk *chunk;
+
+	if (self)
+	{
+		while (self->foreignSize)
+		{
+			--self->foreignSize;
+			QxJsonValue_release(self->foreign[self->foreignSize]);
+		}
+
+		if (self->foreign)
+			QxJsonAllocator_free(self->allocator, self->foreign);
+
+		while (self->chunks)
+		{
+			chunk = self->chunks;
+			self->chunks = chunk->header.next;
+			QxJsonAllocator_free(self->allocator, chunk);
+		}
+
+		QxJsonAllocator_free(self->allocator, self);
+	}
+}
+
+void *QxJsonArena_alloc(QxJsonArena *self, size_t size)
+{
+	ArenaChunk *chunk = self->chunks;
+	size_t chunkSize;
+	void *block;
+
+	size = ARENA_ROUND(size);
+
+	if (!chunk || chunk->header.size - chunk->header.used < size)
+	{
+		/* A new chunk is needed */
+		chunkSize = self->chunkSize;
+
+		while (chunkSize < size)
+			chunkSize *= 2;
+
+		chunk = (ArenaChunk *)QxJsonAllocator_alloc(self->allocator,
+			sizeof(ArenaChunk) + chunkSize);
+
+		if (!chunk)
+			/* Out of memory */
+			return NULL;
+
+		chunk->header.size = chunkSize;
+		chunk->header.used = 0;
+		chunk->header.next = self->chunks;
+		self->chunks = chunk;
+
+		if (self->chunkSize < ARENA_MAX_CHUNK)
+			self->chunkSize *= 2;
+	}
+
+	block = ArenaChunk_data(chunk) + chunk->header.used;
+	chunk->header.used += size;
+	self->last = block;
+	return block;
+}
+
+void *QxJsonArena_realloc(QxJsonArena *self, void *ptr,
+	size_t oldSize, size_t size)
+{
+	ArenaChunk *const chunk = self->chunks;
+	void *block;
+
+	if (!ptr)
+		return QxJsonArena_alloc(self, size);
+
+	oldSize = ARENA_ROUND(oldSize);
+
+	if (ptr == self->last
+		&& chunk->header.size - chunk->header.used + oldSize >= ARENA_ROUND(size))
+	{
+		/* Grow the last block in place */
+		chunk->header.used += ARENA_ROUND(size) - oldSize;
+		return ptr;
+	}
+
+	block = QxJsonArena_alloc(self, size);
+
+	if (block)
+		memcpy(block, ptr, oldSize < size ? oldSize : size);
+
+	return block;
+}
+
+int QxJsonArena_reserve(QxJsonArena *self, size_t count)
+{
+	QxJsonValue **foreign;
+	size_t alloc;
+
+	if (self->foreignAlloc - self->foreignSize >= count)
+		/* Enough room */
+		return 0;
+
+	alloc = self->foreignAlloc ? self->foreignAlloc * 2 : 8;
+
+	while (alloc - self->foreignSize < count)
+		alloc *= 2;
+
+	foreign = (QxJsonValue **)QxJsonAllocator_realloc(self->allocator,
+		self->foreign, alloc * sizeof(QxJsonValue *));
+
+	if (!foreign)
+		/* Out of memory */
+		return -1;
+
+	self->foreign = foreign;
+	self->foreignAlloc = alloc;
+	return 0;
+}
+
+int QxJsonArena_adopt(QxJsonArena *self, QxJsonValue *value)
+{
+	assert(value != NULL);
+
+	if (QxJsonArena_reserve(self, 1) != 0)
+		/* Out of memory */
+		return -1;
+
+	self->foreign[self->foreignSize] = value;
+	++self->foreignSize;
+	return 0;
+}
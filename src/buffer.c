@@ -0,0 +1,826 @@
+/**
+ * @file buffer.c
+ * @brief Source file of the whole buffer parsing.
+ * @author Romain DEOUX
+ */
+
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+#include <wchar.h>
+
+#include "../include/qx.json.parser.h"
+#include "qx.json.private.h"
+
+/* Private structure */
+
+typedef struct BufferLevel
+{
+	QxJsonValue *container;
+	QxJsonValue *key; /* Key of the member being parsed */
+} BufferLevel;
+
+typedef struct Buffer
+{
+	unsigned char const *data;
+	size_t size;
+	unsigned int flags;
+	QxJsonMemory memory;
+	QxJsonScanner const *scanner;
+
+	/* Stage 1: offsets of the structural characters, of the opening quotes
+	 * and of the first character of the other scalars */
+	uint32_t *index;
+	size_t count;
+	size_t alloc;
+	size_t cursor;
+
+	/* Stage 2 */
+	BufferLevel *levels;
+	size_t depth;
+	size_t levelsAlloc;
+	QxJsonValue *root;
+	QxJsonKeyCache keys;
+	wchar_t *text; /* Decoded strings and numbers */
+	size_t textAlloc;
+} Buffer;
+
+#define INDEX_MIN_ALLOC 1024
+#define LEVELS_MIN_ALLOC 16
+#define TEXT_MIN_ALLOC 256
+
+#define IN_RANGE(value, min, max) (((value) >= (min)) && ((value) <= (max)))
+#define isDigit(character) IN_RANGE((character), '0', '9')
+#define isDelimiter(character) ((character) == ' ' || (character) == '\t' \
+	|| (character) == '\n' || (character) == '\r' || (character) == ',' \
+	|| (character) == ']' || (character) == '}' || (character) == ':')
+
+#if defined(__GNUC__)
+#  define lowestBit(bits) ((unsigned int)__builtin_ctzll(bits))
+#else
+static unsigned int lowestBit(uint64_t bits)
+{
+	unsigned int index = 0;
+
+	while (!(bits & 1))
+	{
+		bits >>= 1;
+		++index;
+	}
+
+	return index;
+}
+#endif
+
+/* Private functions */
+
+static int indexBuild(Buffer *self);
+static int indexReserve(Buffer *self);
+static uint64_t findEscaped(uint64_t backslash, uint64_t *carry);
+static uint64_t prefixXor(uint64_t bits);
+
+static int parseDocument(Buffer *self);
+static unsigned char current(Buffer const *self);
+static int parseContainer(Buffer *self, int array);
+static QxJsonValue *parseScalar(Buffer *self);
+static QxJsonValue *parseString(Buffer *self);
+static QxJsonValue *parseNumber(Buffer *self);
+static QxJsonValue *parseLiteral(Buffer *self);
+static int parseKey(Buffer *self);
+static int decodeString(Buffer *self, size_t *size);
+static int decodeUtf8(unsigned char const **data, unsigned char const *end,
+	uint32_t *code);
+static int insertValue(Buffer *self, QxJsonValue *value);
+static int textReserve(Buffer *self, size_t size);
+static void bufferClear(Buffer *self);
+
+/* Public implementations */
+
+int QxJson_parseBuffer(char const *data, size_t size, unsigned int flags,
+	QxJsonValue **value)
+{
+	Buffer self;
+	int error;
+
+	if (!data || !value)
+		/* Invalid argument */
+		return -1;
+
+	if (size >= UINT32_MAX)
+		/* Offsets are 32 bits */
+		return -1;
+
+	memset(&self, 0, sizeof(Buffer));
+	self.data = (unsigned char const *)data;
+	self.size = size;
+	self.flags = flags;
+	self.memory.allocator = QxJson_allocator();
+	self.scanner = QxJsonScanner_get();
+
+	error = indexBuild(&self);
+
+	if (!error)
+		error = parseDocument(&self);
+
+	if (!error)
+	{
+		*value = self.root;
+		self.root = NULL;
+		self.memory.arena = NULL; /* Owned by the root value */
+	}
+
+	bufferClear(&self);
+	return error;
+}
+
+/* Private implementations */
+
+/* Stage 1: classify the blocks and collect the offsets of the structural
+ * characters found out of strings */
+static int indexBuild(Buffer *self)
+{
+	unsigned char padded[QX_JSON_BLOCK_SIZE];
+	unsigned char const *block;
+	QxJsonClasses classes;
+	uint64_t escapeCarry = 0, inStringCarry = 0, scalarCarry = 0;
+	uint64_t quote, inString, scalar, marks;
+	size_t offset;
+
+	for (offset = 0; offset < self->size; offset += QX_JSON_BLOCK_SIZE)
+	{
+		if (self->size - offset >= QX_JSON_BLOCK_SIZE)
+			block = self->data + offset;
+		else
+		{
+			/* The last block is padded with white spaces */
+			memset(padded, ' ', sizeof(padded));
+			memcpy(padded, self->data + offset, self->size - offset);
+			block = padded;
+		}
+
+		self->scanner->utf8Classify(block, &classes);
+
+		quote = classes.quote & ~findEscaped(classes.backslash, &escapeCarry);
+
+		/* Set from an opening quote up to the byte before the closing one */
+		inString = prefixXor(quote) ^ inStringCarry;
+		inStringCarry = (uint64_t)0 - (inString >> 63);
+
+		/* The first byte of literals and numbers, or of garbage */
+		scalar = ~(classes.structural | classes.space | quote | inString);
+		marks = (classes.structural & ~inString)
+			| (quote & inString)
+			| (scalar & ~((scalar << 1) | scalarCarry));
+		scalarCarry = scalar >> 63;
+
+		if (indexReserve(self) != 0)
+			/* Allocation error */
+			return -1;
+
+		while (marks)
+		{
+			self->index[self->count] = (uint32_t)(offset + lowestBit(marks));
+			++self->count;
+			marks &= marks - 1;
+		}
+	}
+
+	if (inStringCarry)
+		/* Unterminated string */
+		return -1;
+
+	return 0;
+}
+
+static int indexReserve(Buffer *self)
+{
+	uint32_t *index;
+	size_t alloc;
+
+	if (self->alloc - self->count >= QX_JSON_BLOCK_SIZE)
+		/* Room for a whole block */
+		return 0;
+
+	alloc = self->alloc ? self->alloc * 2 : INDEX_MIN_ALLOC;
+	index = (uint32_t *)QxJsonAllocator_realloc(self->memory.allocator,
+		self->index, alloc * sizeof(uint32_t));
+
+	if (!index)
+		/* Allocation error */
+		return -1;
+
+	self->index = index;
+	self->alloc = alloc;
+	return 0;
+}
+
+/* Bits of the characters escaped by an odd sequence of backslashes. The carry
+ * tells whether the previous block ended with such a sequence. */
+static uint64_t findEscaped(uint64_t backslash, uint64_t *carry)
+{
+	uint64_t const evenBits = UINT64_C(0x5555555555555555);
+	uint64_t const oddBits = ~evenBits;
+	uint64_t starts, evenStarts, oddStarts, evenCarries, oddCarries;
+	uint64_t evenStartMask;
+	uint64_t ends;
+	uint64_t overflow;
+
+	starts = backslash & ~(backslash << 1);
+	evenStartMask = evenBits ^ *carry;
+	evenStarts = starts & evenStartMask;
+	oddStarts = starts & ~evenStartMask;
+
+	/* Adding the starts to the sequences carries past their ends */
+	evenCarries = backslash + evenStarts;
+	oddCarries = backslash + oddStarts;
+	overflow = oddCarries < backslash;
+	oddCarries |= *carry;
+
+	ends = ((evenCarries & ~backslash) & oddBits)
+		| ((oddCarries & ~backslash) & evenBits);
+
+	*carry = overflow;
+	return ends;
+}
+
+/* Each bit becomes the parity of the bits up to it */
+static uint64_t prefixXor(uint64_t bits)
+{
+	bits ^= bits << 1;
+	bits ^= bits << 2;
+	bits ^= bits << 4;
+	bits ^= bits << 8;
+	bits ^= bits << 16;
+	bits ^= bits << 32;
+	return bits;
+}
+
+/* Stage 2: walk the index and build the values, without recursion */
+static int parseDocument(Buffer *self)
+{
+	BufferLevel *level;
+	unsigned char character;
+	int error;
+
+	for (;;)
+	{
+		/* A value is expected at the cursor */
+		character = current(self);
+
+		if (character == '[' || character == '{')
+			error = parseContainer(self, character == '[');
+		else
+			error = insertValue(self, parseScalar(self));
+
+		if (error < 0)
+			/* Syntax or allocation error */
+			return -1;
+
+		if (error == 0)
+		{
+			/* Within a new container */
+			continue;
+		}
+
+		/* After a complete value */
+		for (;;)
+		{
+			if (!self->depth)
+				/* Nothing may follow the root value */
+				return self->cursor == self->count ? 0 : -1;
+
+			level = &self->levels[self->depth - 1];
+			character = current(self);
+			++self->cursor;
+
+			if (character == ',')
+				break;
+
+			if (character != (QX_JSON_IS_ARRAY(level->container) ? ']' : '}'))
+				/* Unexpected character */
+				return -1;
+
+			--self->depth;
+		}
+
+		if (QX_JSON_IS_OBJECT(level->container) && parseKey(self) != 0)
+			return -1;
+	}
+}
+
+/* The structural character at the cursor, or 0 at the end */
+static unsigned char current(Buffer const *self)
+{
+	if (self->cursor == self->count)
+		return 0;
+
+	return self->data[self->index[self->cursor]];
+}
+
+/* Create and insert a container, then enter it. Returns 1 if it is empty,
+ * hence complete. */
+static int parseContainer(Buffer *self, int array)
+{
+	QxJsonValue *container;
+	BufferLevel *levels;
+	size_t alloc;
+
+	++self->cursor;
+
+	if (!self->depth && (self->flags & QX_JSON_PARSER_ARENA))
+	{
+		/* The root container owns the arena */
+		assert(self->memory.arena == NULL);
+		self->memory.arena = QxJsonArena_new(self->memory.allocator);
+
+		if (!self->memory.arena)
+			/* Allocation error */
+			return -1;
+	}
+
+	if (array)
+		container = QxJsonValue_arrayNewIn(&self->memory);
+	else
+		container = QxJsonValue_objectNewIn(&self->memory);
+
+	if (container && self->memory.arena && !self->depth)
+		QxJsonValue_ownArena(container);
+
+	if (insertValue(self, container) < 0)
+		return -1;
+
+	if (self->depth == QX_JSON_MAX_DEPTH)
+		/* Too deeply nested */
+		return -1;
+
+	if (current(self) == (array ? ']' : '}'))
+	{
+		/* Empty container */
+		++self->cursor;
+		return 1;
+	}
+
+	if (self->depth == self->levelsAlloc)
+	{
+		alloc = self->levelsAlloc ? self->levelsAlloc * 2 : LEVELS_MIN_ALLOC;
+		levels = (BufferLevel *)QxJsonAllocator_realloc(self->memory.allocator,
+			self->levels, alloc * sizeof(BufferLevel));
+
+		if (!levels)
+			/* Allocation error */
+			return -1;
+
+		self->levels = levels;
+		self->levelsAlloc = alloc;
+	}
+
+	self->levels[self->depth].container = container;
+	self->levels[self->depth].key = NULL;
+	++self->depth;
+
+	if (!array && parseKey(self) != 0)
+		return -1;
+
+	return 0;
+}
+
+static QxJsonValue *parseScalar(Buffer *self)
+{
+	switch (current(self))
+	{
+	case '"':
+		return parseString(self);
+
+	case '-':
+	case '0': case '1': case '2': case '3': case '4':
+	case '5': case '6': case '7': case '8': case '9':
+		return parseNumber(self);
+
+	case 't':
+	case 'f':
+	case 'n':
+		return parseLiteral(self);
+
+	default:
+		/* Unexpected character */
+		return NULL;
+	}
+}
+
+static QxJsonValue *parseString(Buffer *self)
+{
+	size_t size;
+
+	if (decodeString(self, &size) != 0)
+		return NULL;
+
+	if (self->flags & QX_JSON_PARSER_UTF8_STRINGS)
+		return QxJsonValue_stringNewAsUtf8In(&self->memory, self->text, size);
+
+	return QxJsonValue_stringNewIn(&self->memory, self->text, size);
+}
+
+/* A key, its colon, and the cursor on the value */
+static int parseKey(Buffer *self)
+{
+	BufferLevel *const level = &self->levels[self->depth - 1];
+	size_t size;
+
+	if (current(self) != '"' || decodeString(self, &size) != 0)
+		/* Key expected */
+		return -1;
+
+	assert(level->key == NULL);
+	level->key = QxJsonKeyCache_get(&self->keys, &self->memory, self->text, size,
+		self->flags & QX_JSON_PARSER_UTF8_STRINGS);
+
+	if (!level->key)
+		/* Allocation error */
+		return -1;
+
+	if (current(self) != ':')
+		/* Colon expected */
+		return -1;
+
+	++self->cursor;
+	return 0;
+}
+
+/* Decode the string at the cursor into the text buffer */
+static int decodeString(Buffer *self, size_t *size)
+{
+	unsigned char const *data = self->data + self->index[self->cursor] + 1;
+	unsigned char const *const end = self->data + self->size;
+	size_t run, length = 0;
+	uint32_t code;
+	unsigned int digits;
+	int digit;
+
+	for (;;)
+	{
+		run = self->scanner->utf8String(data, (size_t)(end - data));
+
+		/* Room for the run, then a surrogate pair or the nul character */
+		if (textReserve(self, length + run + 2) != 0)
+			return -1;
+
+		for (; run; --run)
+			self->text[length++] = (wchar_t)*data++;
+
+		if (data == end)
+			/* Already checked by stage 1 */
+			return -1;
+
+		if (*data == '"')
+			break;
+
+		if (*data == '\\')
+		{
+			if (end - data < 2)
+				return -1;
+
+			switch (data[1])
+			{
+			case '"':  code = '"';  break;
+			case '\\': code = '\\'; break;
+			case '/':  code = '/';  break;
+			case 'b':  code = '\b'; break;
+			case 'f':  code = '\f'; break;
+			case 'n':  code = '\n'; break;
+			case 'r':  code = '\r'; break;
+			case 't':  code = '\t'; break;
+
+			case 'u':
+				if (end - data < 6)
+					return -1;
+
+				for (code = 0, digits = 2; digits != 6; ++digits)
+				{
+					if (isDigit(data[digits]))
+						digit = data[digits] - '0';
+					else if (IN_RANGE(data[digits], 'a', 'f'))
+						digit = data[digits] - 'a' + 10;
+					else if (IN_RANGE(data[digits], 'A', 'F'))
+						digit = data[digits] - 'A' + 10;
+					else
+						/* Unexpected character */
+						return -1;
+
+					code = (code << 4) | (uint32_t)digit;
+				}
+
+				data += 4;
+				break;
+
+			default:
+				/* Unsupported escaped sequence */
+				return -1;
+			}
+
+			data += 2;
+			self->text[length++] = (wchar_t)code;
+		}
+		else if (*data < 0x20)
+			/* Control characters must be escaped */
+			return -1;
+		else if (decodeUtf8(&data, end, &code) != 0)
+			return -1;
+		else
+		{
+#if WCHAR_MAX < 0x10FFFF
+			if (code >= 0x10000)
+			{
+				/* Encode as an UTF-16 surrogate pair */
+				code -= 0x10000;
+				self->text[length++] = (wchar_t)(0xD800 | (code >> 10));
+				code = 0xDC00 | (code & 0x3FF);
+			}
+#endif
+			self->text[length++] = (wchar_t)code;
+		}
+	}
+
+	self->text[length] = L'\0';
+	*size = length;
+
+	/* The closing quote is not indexed */
+	++self->cursor;
+	return 0;
+}
+
+/* Decode a multi-byte UTF-8 sequence */
+static int decodeUtf8(unsigned char const **data, unsigned char const *end,
+	uint32_t *code)
+{
+	unsigned char const *current = *data;
+	unsigned int pending;
+	uint32_t value, min;
+
+	if (IN_RANGE(*current, 0xC2, 0xDF))
+	{
+		value = *current & 0x1F;
+		min = 0x80;
+		pending = 1;
+	}
+	else if (IN_RANGE(*current, 0xE0, 0xEF))
+	{
+		value = *current & 0x0F;
+		min = 0x800;
+		pending = 2;
+	}
+	else if (IN_RANGE(*current, 0xF0, 0xF4))
+	{
+		value = *current & 0x07;
+		min = 0x10000;
+		pending = 3;
+	}
+	else
+		/* Invalid leading byte */
+		return -1;
+
+	if ((size_t)(end - current) <= pending)
+		/* Truncated sequence */
+		return -1;
+
+	for (++current; pending; --pending, ++current)
+	{
+		if ((*current & 0xC0) != 0x80)
+			/* Continuation byte expected */
+			return -1;
+
+		value = (value << 6) | (*current & 0x3F);
+	}
+
+	if (value < min || value > 0x10FFFF || IN_RANGE(value, 0xD800, 0xDFFF))
+		/* Overlong encoding / out of range / surrogate */
+		return -1;
+
+	*data = current;
+	*code = value;
+	return 0;
+}
+
+static QxJsonValue *parseNumber(Buffer *self)
+{
+	unsigned char const *const start = self->data + self->index[self->cursor];
+	unsigned char const *const end = self->data + self->size;
+	unsigned char const *data = start;
+	QxJsonNumber number;
+	uint64_t magnitude;
+	size_t size, index;
+	int64_t value;
+	double real;
+
+	memset(&number, 0, sizeof(QxJsonNumber));
+
+	if (*data == '-')
+	{
+		number.negative = 1;
+		++data;
+	}
+
+	/* Integer part */
+	if (data == end || !isDigit(*data))
+		return NULL;
+
+	if (*data == '0')
+		QxJsonNumber_digit(&number, (wchar_t)*data++, 0);
+	else
+	{
+		while (data != end && isDigit(*data))
+			QxJsonNumber_digit(&number, (wchar_t)*data++, 0);
+	}
+
+	/* Fraction */
+	if (data != end && *data == '.')
+	{
+		if (++data == end || !isDigit(*data))
+			return NULL;
+
+		while (data != end && isDigit(*data))
+			QxJsonNumber_digit(&number, (wchar_t)*data++, 1);
+	}
+
+	/* Exponent */
+	if (data != end && (*data == 'e' || *data == 'E'))
+	{
+		if (++data != end && (*data == '+' || *data == '-'))
+			number.exponentNegative = *data++ == '-';
+
+		if (data == end || !isDigit(*data))
+			return NULL;
+
+		while (data != end && isDigit(*data))
+			QxJsonNumber_exponentDigit(&number, (wchar_t)*data++);
+	}
+
+	if (data != end && !isDelimiter(*data))
+		/* Garbage after the number */
+		return NULL;
+
+	/* The decoding functions work on wide text */
+	size = (size_t)(data - start);
+
+	if (textReserve(self, size + 1) != 0)
+		return NULL;
+
+	for (index = 0; index != size; ++index)
+		self->text[index] = (wchar_t)start[index];
+
+	self->text[size] = L'\0';
+	++self->cursor;
+
+	if (self->flags & QX_JSON_PARSER_LAZY_NUMBERS)
+		return QxJsonValue_numberNewTextIn(&self->memory, self->text, size);
+
+	if (QxJsonNumber_toInteger(&number, self->text, size, &magnitude) != 0)
+	{
+		if (QxJsonNumber_toDouble(&number, self->memory.allocator,
+				self->text, size, &real) != 0)
+			/* Out of memory */
+			return NULL;
+
+		return QxJsonValue_numberNewIn(&self->memory, real);
+	}
+
+	if (!number.negative)
+		return QxJsonValue_numberNewUint64In(&self->memory, magnitude);
+
+	/* Avoid overflowing with INT64_MIN */
+	value = -(int64_t)(magnitude - 1) - 1;
+	return QxJsonValue_numberNewInt64In(&self->memory, value);
+}
+
+static QxJsonValue *parseLiteral(Buffer *self)
+{
+	unsigned char const *const data = self->data + self->index[self->cursor];
+	size_t const left = self->size - self->index[self->cursor];
+	QxJsonValue *value;
+	size_t size;
+
+	if (left >= 4 && memcmp(data, "true", 4) == 0)
+	{
+		size = 4;
+		value = QxJsonValue_trueNewIn(&self->memory);
+	}
+	else if (left >= 5 && memcmp(data, "false", 5) == 0)
+	{
+		size = 5;
+		value = QxJsonValue_falseNewIn(&self->memory);
+	}
+	else if (left >= 4 && memcmp(data, "null", 4) == 0)
+	{
+		size = 4;
+		value = QxJsonValue_nullNewIn(&self->memory);
+	}
+	else
+		/* Unexpected character */
+		return NULL;
+
+	if (value && size < left && !isDelimiter(data[size]))
+	{
+		/* Garbage after the literal */
+		QxJsonValue_release(value);
+		return NULL;
+	}
+
+	++self->cursor;
+	return value;
+}
+
+/* Insert a complete or new value into the current container, or set the
+ * root. Returns 1 on success. */
+static int insertValue(Buffer *self, QxJsonValue *value)
+{
+	BufferLevel *level;
+	int error;
+
+	if (!value)
+		/* Syntax or allocation error */
+		return -1;
+
+	if (!self->depth)
+	{
+		assert(self->root == NULL);
+		self->root = value;
+		return 1;
+	}
+
+	level = &self->levels[self->depth - 1];
+
+	if (QX_JSON_IS_ARRAY(level->container))
+	{
+		error = QxJsonValue_arrayAppendNew(level->container, value);
+
+		if (error)
+		{
+			/* Failed to insert the value */
+			QxJsonValue_release(value);
+			return -1;
+		}
+
+		return 1;
+	}
+
+	assert(level->key != NULL);
+	error = QxJsonValue_objectSet(level->container, level->key, value);
+	QxJsonValue_release(level->key);
+	level->key = NULL;
+	QxJsonValue_release(value);
+	return error ? -1 : 1;
+}
+
+static int textReserve(Buffer *self, size_t size)
+{
+	wchar_t *text;
+	size_t alloc;
+
+	if (size <= self->textAlloc)
+		/* Enough room */
+		return 0;
+
+	alloc = self->textAlloc ? self->textAlloc : TEXT_MIN_ALLOC;
+
+	while (alloc < size)
+		alloc *= 2;
+
+	text = (wchar_t *)QxJsonAllocator_realloc(self->memory.allocator,
+		self->text, alloc * sizeof(wchar_t));
+
+	if (!text)
+		/* Allocation error */
+		return -1;
+
+	self->text = text;
+	self->textAlloc = alloc;
+	return 0;
+}
+
+static void bufferClear(Buffer *self)
+{
+	while (self->depth)
+	{
+		--self->depth;
+
+		if (self->levels[self->depth].key)
+			QxJsonValue_release(self->levels[self->depth].key);
+	}
+
+	/* Before the arena keys go away */
+	QxJsonKeyCache_clear(&self->keys);
+
+	if (self->root)
+		/* Frees the arena too, if any */
+		QxJsonValue_release(self->root);
+	else if (self->memory.arena)
+		QxJsonArena_delete(self->memory.arena);
+
+	if (self->index)
+		QxJsonAllocator_free(self->memory.allocator, self->index);
+
+	if (self->levels)
+		QxJsonAllocator_free(self->memory.allocator, self->levels);
+
+	if (self->text)
+		QxJsonAllocator_free(self->memory.allocator, self->text);
+}
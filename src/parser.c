@@ -11,15 +11,10 @@
 #include <wchar.h>
 
 #include "../include/qx.json.parser.h"
+#include "qx.json.private.h"
 
 /* Private structure */
 
-typedef struct TokenStep
-{
-	int (*const feedChar)(QxJsonParser *self, wchar_t character);
-	int (*const endOfStream)(QxJsonParser *self);
-} TokenStep;
-
 typedef enum QxJsonTokenType
 {
 	QxJsonTokenString,
@@ -35,154 +30,284 @@ typedef enum QxJsonTokenType
 	QxJsonTokenEndObject
 } QxJsonTokenType;
 
-typedef struct SyntaxStep
+/* States of the token level */
+typedef enum QxJsonTokenState
 {
-	int(*feed)(QxJsonParser *self);
-	int(*canFeed)(QxJsonTokenType type);
-} SyntaxStep;
+	QxJsonStateDefault,
+	QxJsonStateString,
+	QxJsonStateEscape,
+	QxJsonStateUnicode,
+	QxJsonStateLiteral,
+	QxJsonStateNumberMinus,
+	QxJsonStateNumberZero,
+	QxJsonStateNumberInteger,
+	QxJsonStateNumberDot,
+	QxJsonStateNumberFrac,
+	QxJsonStateNumberExp,
+	QxJsonStateNumberExpSign,
+	QxJsonStateNumberExpInteger,
+	QxJsonStateSkip
+} QxJsonTokenState;
+
+/* States of the syntax level, named after the last token */
+typedef enum QxJsonSyntaxState
+{
+	QxJsonSyntaxVoid,
+	QxJsonSyntaxValue,
+	QxJsonSyntaxArrayBegin,
+	QxJsonSyntaxArrayValue,
+	QxJsonSyntaxArrayComma,
+	QxJsonSyntaxObjectBegin,
+	QxJsonSyntaxObjectKey,
+	QxJsonSyntaxObjectColon,
+	QxJsonSyntaxObjectValue,
+	QxJsonSyntaxObjectComma
+} QxJsonSyntaxState;
 
 typedef struct StackValue
 {
 	QxJsonValue *value;
-	struct StackValue *next;
+	QxJsonProjectionNode const *node; /* NULL if the whole value is selected */
+	size_t index; /* Index of the next item of an array */
 } StackValue;
 
-#define StackValue_alloc() ((StackValue *)malloc(sizeof(StackValue)))
+#define STACK_MIN_ALLOC 16
+
+/* Kinds of the nested containers */
+#define NESTING_ARRAY  0
+#define NESTING_OBJECT 1
+#define NESTING_MIN_ALLOC 16
+
+/* Skipping states */
+#define SKIP_PENDING   0x1 /* Skip the value after the next colon */
+#define SKIP_CONTAINER 0x2 /* Skip the rest of the current container */
+#define SKIP_STARTED   0x4 /* The skipped value has started */
+#define SKIP_STRING    0x8 /* Within a string */
+#define SKIP_ESCAPE   0x10 /* After a backslash within a string */
+
+/* The token text, never NULL */
+#define bufferString(parser) ((parser)->bufferSize ? (parser)->bufferData : L"")
+
+/* UTF-8 input is decoded by chunks of wide characters */
+#define CHUNK_SIZE 256
+
+/* Classes of the characters out of the tokens */
+#define CLASS_INVALID       0
+#define CLASS_SPACE         1
+#define CLASS_QUOTE         2
+#define CLASS_MINUS         3
+#define CLASS_ZERO          4
+#define CLASS_DIGIT         5
+#define CLASS_FALSE         6
+#define CLASS_TRUE          7
+#define CLASS_NULL          8
+#define CLASS_BEGIN_ARRAY   9
+#define CLASS_COMMA        10
+#define CLASS_END_ARRAY    11
+#define CLASS_BEGIN_OBJECT 12
+#define CLASS_COLON        13
+#define CLASS_END_OBJECT   14
+
+#define classOf(character) \
+	((unsigned long)(character) < 0x80 ? charClasses[(character)] : CLASS_INVALID)
+
+/* Actions of the syntax level */
+#define ACTION_ERROR        0 /* Unexpected token */
+#define ACTION_ROOT         1 /* Root value */
+#define ACTION_ITEM         2 /* Array item */
+#define ACTION_MEMBER       3 /* Object member value */
+#define ACTION_KEY          4 /* Object member key */
+#define ACTION_COLON        5
+#define ACTION_ITEM_COMMA   6
+#define ACTION_MEMBER_COMMA 7
+#define ACTION_END          8 /* End of the current container */
 
 /* Private functions */
 
 #define IN_RANGE(value, min, max) (((value) >= (min)) && ((value) <= (max)))
 #define WITHIN_0_9(value)  IN_RANGE((value), L'0', L'9')
-#define WITHIN_1_9(value)  IN_RANGE((value), L'1', L'9')
 #define WITHIN_a_f(value)  IN_RANGE((value), L'a', L'f')
 #define WITHIN_A_F(value)  IN_RANGE((value), L'A', L'F')
 
-static int feedDefault(QxJsonParser *self, wchar_t character);
-static int feedString(QxJsonParser *self, wchar_t character);
-static int feedStringEscape(QxJsonParser *self, wchar_t character);
-static int feedStringUnicode(QxJsonParser *self, wchar_t character);
-static int feedStringUnicode0(QxJsonParser *self, wchar_t character);
-static int feedStringUnicode1(QxJsonParser *self, wchar_t character);
-static int feedStringUnicode2(QxJsonParser *self, wchar_t character);
-static int feedF(QxJsonParser *self, wchar_t character);
-static int feedFa(QxJsonParser *self, wchar_t character);
-static int feedFal(QxJsonParser *self, wchar_t character);
-static int feedFals(QxJsonParser *self, wchar_t character);
-static int feedN(QxJsonParser *self, wchar_t character);
-static int feedNu(QxJsonParser *self, wchar_t character);
-static int feedNul(QxJsonParser *self, wchar_t character);
-static int feedT(QxJsonParser *self, wchar_t character);
-static int feedTr(QxJsonParser *self, wchar_t character);
-static int feedTru(QxJsonParser *self, wchar_t character);
-static int feedNumberMinus(QxJsonParser *self, wchar_t character);
-static int feedNumberZero(QxJsonParser *self, wchar_t character);
-static int feedNumberInteger(QxJsonParser *self, wchar_t character);
-static int feedNumberDot(QxJsonParser *self, wchar_t character);
-static int feedNumberFrac(QxJsonParser *self, wchar_t character);
-static int feedNumberExp(QxJsonParser *self, wchar_t character);
-static int feedNumberExpSign(QxJsonParser *self, wchar_t character);
-static int feedNumberExpInteger(QxJsonParser *self, wchar_t character);
-
-static int endDefault(QxJsonParser *self);
-static int endUnexpected(QxJsonParser *self);
-static int endNumber(QxJsonParser *self);
-
+static int feedChars(QxJsonParser *self, wchar_t const *data, size_t size);
+static int beginToken(QxJsonParser *self, wchar_t const *data, size_t size,
+	size_t *count);
+static int numberDigits(QxJsonParser *self, wchar_t const *data, size_t size,
+	size_t *count);
+static int endToken(QxJsonParser *self);
+
+static int skipChars(QxJsonParser *self, wchar_t const *data, size_t size,
+	size_t *count);
+static int skipDone(QxJsonParser *self, wchar_t character);
+
+static int stringBytes(QxJsonParser *self, unsigned char const *data,
+	size_t size, size_t *count);
+static int decodeUtf8(QxJsonParser *self, unsigned char const *data,
+	size_t size, wchar_t *chunk, size_t *count, size_t *consumed);
+static int decodeUtf8Byte(QxJsonParser *self, unsigned char byte);
+static int bufferReserve(QxJsonParser *self, size_t size);
+static void bufferShrink(QxJsonParser *self, int force);
+static int bufferAppend(QxJsonParser *self, wchar_t const *data, size_t size);
 static int wcharToBuffer(QxJsonParser *self, wchar_t character);
 static int raiseToken(QxJsonParser *self, QxJsonTokenType type);
 
-static int feedAfterVoid(QxJsonParser *self);
-static int feedAfterValue(QxJsonParser *self);
-static int feedAfterArrayBegin(QxJsonParser *self);
-static int feedAfterArrayValue(QxJsonParser *self);
-static int feedAfterArrayComma(QxJsonParser *self);
-static int feedAfterObjectBegin(QxJsonParser *self);
-static int feedAfterObjectKey(QxJsonParser *self);
-static int feedAfterObjectColon(QxJsonParser *self);
-static int feedAfterObjectValue(QxJsonParser *self);
-static int feedAfterObjectComma(QxJsonParser *self);
-static int canFeedTokenAfterVoid(QxJsonTokenType type);
-static int canFeedTokenAfterValue(QxJsonTokenType type);
-static int canFeedTokenAfterArrayBegin(QxJsonTokenType type);
-static int canFeedTokenAfterArrayValue(QxJsonTokenType type);
-static int canFeedTokenAfterArrayComma(QxJsonTokenType type);
-static int canFeedTokenAfterObjectBegin(QxJsonTokenType type);
-static int canFeedTokenAfterObjectKey(QxJsonTokenType type);
-static int canFeedTokenAfterObjectColon(QxJsonTokenType type);
-static int canFeedTokenAfterObjectValue(QxJsonTokenType type);
-static int canFeedTokenAfterObjectComma(QxJsonTokenType type);
-static void popStackItem(QxJsonParser *self);
-static QxJsonValue *createValueFromToken(QxJsonParser *self);
+static int popStackItem(QxJsonParser *self);
+static int pushStackItem(QxJsonParser *self, unsigned char kind);
+static int raiseValue(QxJsonParser *self, QxJsonTokenType type,
+	QxJsonSyntaxState next);
+
+static int domBeginArray(void *ptr);
+static int domEndArray(void *ptr);
+static int domBeginObject(void *ptr);
+static int domEndObject(void *ptr);
+static int domKey(void *ptr, wchar_t const *data, size_t size);
+static int domString(void *ptr, wchar_t const *data, size_t size);
+static int domNumber(void *ptr, double value);
+static int domNumberText(QxJsonParser *self);
+static int domInteger(void *ptr, int64_t value);
+static int domUnsignedInteger(void *ptr, uint64_t value);
+static int domBoolean(void *ptr, int value);
+static int domNull(void *ptr);
+static void domClear(QxJsonParser *self);
 
 /* Private constants */
 
 #define Yes  1
 #define No   0
 
-static TokenStep const stepDefault = { &feedDefault, &endDefault };
-static TokenStep const stepString = { &feedString, &endUnexpected };
-static TokenStep const stepStringEscape = { &feedStringEscape, endUnexpected };
-static TokenStep const stepStringUnicode  = { &feedStringUnicode  , endUnexpected  };
-static TokenStep const stepStringUnicode0 = { &feedStringUnicode0 , &endUnexpected };
-static TokenStep const stepStringUnicode1 = { &feedStringUnicode1 , &endUnexpected };
-static TokenStep const stepStringUnicode2 = { &feedStringUnicode2 , &endUnexpected };
-static TokenStep const stepF    = { &feedF    , &endUnexpected };
-static TokenStep const stepFa   = { &feedFa   , &endUnexpected };
-static TokenStep const stepFal  = { &feedFal  , &endUnexpected };
-static TokenStep const stepFals = { &feedFals , &endUnexpected };
-static TokenStep const stepN   = { &feedN   , &endUnexpected };
-static TokenStep const stepNu  = { &feedNu  , &endUnexpected };
-static TokenStep const stepNul = { &feedNul , &endUnexpected };
-static TokenStep const stepT   = { &feedT   , &endUnexpected };
-static TokenStep const stepTr  = { &feedTr  , &endUnexpected };
-static TokenStep const stepTru = { &feedTru , &endUnexpected };
-static TokenStep const stepNumberMinus = { &feedNumberMinus , &endUnexpected };
-static TokenStep const stepNumberZero = { &feedNumberZero , endNumber };
-static TokenStep const stepNumberInteger = { &feedNumberInteger , &endNumber };
-static TokenStep const stepNumberDot = { &feedNumberDot , &endUnexpected };
-static TokenStep const stepNumberFrac = { &feedNumberFrac , &endNumber };
-static TokenStep const stepNumberExp = { &feedNumberExp , &endUnexpected };
-static TokenStep const stepNumberExpSign = { &feedNumberExpSign , &endUnexpected };
-static TokenStep const stepNumberExpInteger = { &feedNumberExpInteger, &endNumber };
-
-static SyntaxStep const stepVoid = { &feedAfterVoid, &canFeedTokenAfterVoid };
-static SyntaxStep const stepValue = { &feedAfterValue, &canFeedTokenAfterValue };
-static SyntaxStep const stepArrayBegin = { &feedAfterArrayBegin, &canFeedTokenAfterArrayBegin };
-static SyntaxStep const stepArrayValue = { &feedAfterArrayValue, &canFeedTokenAfterArrayValue };
-static SyntaxStep const stepArrayComma = { &feedAfterArrayComma, &canFeedTokenAfterArrayComma };
-static SyntaxStep const stepObjectBegin = { &feedAfterObjectBegin, &canFeedTokenAfterObjectBegin };
-static SyntaxStep const stepObjectKey = { &feedAfterObjectKey, &canFeedTokenAfterObjectKey };
-static SyntaxStep const stepObjectColon = { &feedAfterObjectColon, &canFeedTokenAfterObjectColon };
-static SyntaxStep const stepObjectValue = { &feedAfterObjectValue, &canFeedTokenAfterObjectValue };
-static SyntaxStep const stepObjectComma = { &feedAfterObjectComma, &canFeedTokenAfterObjectComma };
+/* Classes of the ASCII characters */
+static unsigned char const charClasses[128] = {
+	 0,  0,  0,  0,  0,  0,  0,  0,  0,  1,  1,  0,  0,  1,  0,  0, /* \t \n \r */
+	 0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+	 1,  0,  2,  0,  0,  0,  0,  0,  0,  0,  0,  0, 10,  3,  0,  0, /* space " , - */
+	 4,  5,  5,  5,  5,  5,  5,  5,  5,  5, 13,  0,  0,  0,  0,  0, /* 0-9 : */
+	 0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+	 0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  9,  0, 11,  0,  0, /* [ ] */
+	 0,  0,  0,  0,  0,  0,  6,  0,  0,  0,  0,  0,  0,  0,  8,  0, /* f n */
+	 0,  0,  0,  0,  7,  0,  0,  0,  0,  0,  0, 12,  0, 14,  0,  0  /* t { } */
+};
+
+/* Token started by each class */
+static QxJsonTokenType const classTokens[] = {
+	QxJsonTokenString, QxJsonTokenString, /* Unused */
+	QxJsonTokenString,
+	QxJsonTokenNumber, QxJsonTokenNumber, QxJsonTokenNumber,
+	QxJsonTokenFalse, QxJsonTokenTrue, QxJsonTokenNull,
+	QxJsonTokenBeginArray, QxJsonTokenValuesSeparator, QxJsonTokenEndArray,
+	QxJsonTokenBeginObject, QxJsonTokenNameValueSeparator, QxJsonTokenEndObject
+};
+
+/* Literal tokens, from QxJsonTokenFalse */
+static wchar_t const *const literals[] = { L"false", L"true", L"null" };
+static size_t const literalSizes[] = { 5, 4, 4 };
+
+/* Syntax actions by state and token:
+ * string, number, false, true, null, [ , ] { : } */
+static unsigned char const syntaxActions[][11] = {
+	{ 1, 1, 1, 1, 1, 1, 0, 0, 1, 0, 0 }, /* Void */
+	{ 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 }, /* Value */
+	{ 2, 2, 2, 2, 2, 2, 0, 8, 2, 0, 0 }, /* ArrayBegin */
+	{ 0, 0, 0, 0, 0, 0, 6, 8, 0, 0, 0 }, /* ArrayValue */
+	{ 2, 2, 2, 2, 2, 2, 0, 0, 2, 0, 0 }, /* ArrayComma */
+	{ 4, 0, 0, 0, 0, 0, 0, 0, 0, 0, 8 }, /* ObjectBegin */
+	{ 0, 0, 0, 0, 0, 0, 0, 0, 0, 5, 0 }, /* ObjectKey */
+	{ 3, 3, 3, 3, 3, 3, 0, 0, 3, 0, 0 }, /* ObjectColon */
+	{ 0, 0, 0, 0, 0, 0, 7, 0, 0, 0, 8 }, /* ObjectValue */
+	{ 4, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 }  /* ObjectComma */
+};
+
+/* Builds QxJsonValue documents */
+static QxJsonHandler const domHandler = {
+	&domBeginArray, &domEndArray,
+	&domBeginObject, &domEndObject,
+	&domKey, &domString, &domNumber, &domBoolean, &domNull,
+	&domInteger, &domUnsignedInteger
+};
 
 /* Public implementations */
 
 struct QxJsonParser
 {
 	/* Token level */
-	TokenStep const *tokenStep;
-	QxJsonTokenType tokenType;
+	QxJsonTokenState tokenState;
+	wchar_t const *literal; /* Characters left of a literal */
+	QxJsonTokenType literalType;
+	unsigned int hexaDigits; /* Digits read of an unicode escape */
 	wchar_t *bufferData;
 	size_t bufferSize;
 	size_t bufferAlloc;
+	size_t bufferCapacity;
+	size_t bufferPeak; /* Longest token of the document */
+	QxJsonNumber number;
+	QxJsonScanner const *scanner;
+
+	/* Skipping level */
+	size_t skipDepth;
+	unsigned int skipFlags;
+
+	/* UTF-8 decoding level */
+	unsigned long utf8Code;
+	unsigned long utf8Min;
+	unsigned int utf8Pending;
 
 	/* Syntax level */
+	QxJsonSyntaxState syntaxState;
+	unsigned char *nestingData;
+	size_t nestingSize;
+	size_t nestingAlloc;
+	size_t maxDepth; /* 0 if unlimited */
+
+	/* Event level */
+	QxJsonHandler const *handler;
+	void *handlerPtr;
+
+	/* Document level */
+	unsigned int flags;
+	QxJsonMemory memory;
 	QxJsonValue *key;
-	SyntaxStep const *syntaxStep;
-	StackValue head;
+	QxJsonKeyCache keys;
+	QxJsonValue *root;
+	StackValue *stackData; /* Containers being built, kept between documents */
+	size_t stackSize;
+	size_t stackAlloc;
+
+	/* Projection level */
+	QxJsonProjection const *projection;
+	QxJsonProjectionNode const *match; /* Node of the current member */
+	int skipped; /* A skipped container is ending */
 };
 
+#define stackTop(self) \
+	((self)->stackSize ? (self)->stackData + (self)->stackSize - 1 : NULL)
+
+#define isParsing(self) \
+	((self)->syntaxState != QxJsonSyntaxVoid || (self)->tokenState != QxJsonStateDefault)
+
 QxJsonParser *QxJsonParser_new(void)
+{
+	return QxJsonParser_newWithAllocator(NULL);
+}
+
+QxJsonParser *QxJsonParser_newWithAllocator(QxJsonAllocator const *allocator)
 {
 	QxJsonParser *instance;
 
-	instance = (QxJsonParser *)malloc(sizeof(QxJsonParser));
+	if (!allocator)
+		allocator = QxJson_allocator();
+
+	instance = (QxJsonParser *)QxJsonAllocator_alloc(allocator, sizeof(QxJsonParser));
 
 	if (instance)
 	{
 		memset(instance, 0, sizeof(QxJsonParser));
-		instance->tokenStep = &stepDefault;
-		instance->syntaxStep = &stepVoid;
+		instance->memory.allocator = allocator;
+		instance->scanner = QxJsonScanner_get();
+		instance->bufferCapacity = QX_JSON_BUFFER_CAPACITY;
+		instance->maxDepth = QX_JSON_MAX_DEPTH;
+		instance->tokenState = QxJsonStateDefault;
+		instance->syntaxState = QxJsonSyntaxVoid;
+		instance->handler = &domHandler;
+		instance->handlerPtr = instance;
 	}
 
 	return instance;
@@ -190,58 +315,197 @@ QxJsonParser *QxJsonParser_new(void)
 
 void QxJsonParser_release(QxJsonParser *self)
 {
-	StackValue *item;
-
 	if (self)
 	{
-		if (self->head.value)
-		{
-			QxJsonValue_release(self->head.next->value);
+		domClear(self);
 
-			if (self->key)
-				QxJsonValue_release(self->key);
+		if (self->nestingData)
+			QxJsonAllocator_free(self->memory.allocator, self->nestingData);
 
-			while (self->head.next)
-			{
-				item = self->head.next;
-				self->head.next = item->next;
-				free(item);
-			}
-		}
+		if (self->stackData)
+			QxJsonAllocator_free(self->memory.allocator, self->stackData);
 
 		if (self->bufferData)
 		{
 			assert(self->bufferAlloc > 0);
-			free(self->bufferData);
+			QxJsonAllocator_free(self->memory.allocator, self->bufferData);
 		}
 
-		free(self);
+		QxJsonAllocator_free(self->memory.allocator, self);
+	}
+}
+
+void QxJsonParser_reset(QxJsonParser *self)
+{
+	if (self)
+	{
+		/* Partially built document */
+		domClear(self);
+
+		self->tokenState = QxJsonStateDefault;
+		self->syntaxState = QxJsonSyntaxVoid;
+		self->nestingSize = 0;
+		self->skipFlags = 0;
+		self->skipDepth = 0;
+		self->utf8Pending = 0;
+		self->match = NULL;
+		bufferShrink(self, No);
+	}
+}
+
+int QxJsonParser_setFlags(QxJsonParser *self, unsigned int flags)
+{
+	if (!self || isParsing(self))
+		/* Invalid argument / parsing in progress */
+		return -1;
+
+	self->flags = flags;
+	return 0;
+}
+
+int QxJsonParser_setBufferCapacity(QxJsonParser *self, size_t capacity)
+{
+	if (!self || isParsing(self))
+		/* Invalid argument / parsing in progress */
+		return -1;
+
+	self->bufferCapacity = capacity;
+	bufferShrink(self, Yes);
+	return 0;
+}
+
+int QxJsonParser_setMaxDepth(QxJsonParser *self, size_t depth)
+{
+	if (!self || isParsing(self))
+		/* Invalid argument / parsing in progress */
+		return -1;
+
+	self->maxDepth = depth;
+	return 0;
+}
+
+int QxJsonParser_setProjection(QxJsonParser *self,
+	QxJsonProjection const *projection)
+{
+	if (!self || isParsing(self))
+		/* Invalid argument / parsing in progress */
+		return -1;
+
+	self->projection = projection;
+	return 0;
+}
+
+int QxJsonParser_setHandler(QxJsonParser *self,
+	QxJsonHandler const *handler, void *ptr)
+{
+	if (!self || isParsing(self))
+		/* Invalid argument / parsing in progress */
+		return -1;
+
+	if (handler)
+	{
+		self->handler = handler;
+		self->handlerPtr = ptr;
+	}
+	else
+	{
+		self->handler = &domHandler;
+		self->handlerPtr = self;
+	}
+
+	return 0;
+}
+
+int QxJsonParser_skip(QxJsonParser *self)
+{
+	if (!self || self->tokenState != QxJsonStateDefault)
+		/* Invalid argument / not called from a handler */
+		return -1;
+
+	if (self->syntaxState == QxJsonSyntaxObjectKey)
+	{
+		self->skipFlags = SKIP_PENDING;
+		return 0;
+	}
+
+	if (self->syntaxState == QxJsonSyntaxArrayBegin
+		|| self->syntaxState == QxJsonSyntaxObjectBegin)
+	{
+		self->tokenState = QxJsonStateSkip;
+		self->skipFlags = SKIP_CONTAINER | SKIP_STARTED;
+		self->skipDepth = 1;
+		return 0;
 	}
+
+	/* Nothing to skip */
+	return -1;
 }
 
 int QxJsonParser_feed(QxJsonParser *self, wchar_t const *data, size_t size)
 {
+	if (!self || !data || self->utf8Pending)
+		/* Invalid argument / truncated UTF-8 sequence */
+		return -1;
+
+	return feedChars(self, data, size);
+}
+
+int QxJsonParser_feedUtf8(QxJsonParser *self, char const *data, size_t size)
+{
+	wchar_t chunk[CHUNK_SIZE];
+	size_t count, consumed;
+	int decoding;
 	int error = 0;
 
 	if (!self || !data)
 		/* Invalid argument */
 		return -1;
 
-	for (; size && !error; ++data, --size)
-		error = self->tokenStep->feedChar(self, *data);
+	while (size && !error)
+	{
+		if (self->tokenState == QxJsonStateString && !self->utf8Pending)
+		{
+			/* Runs of plain ASCII characters are copied at once */
+			error = stringBytes(self, (unsigned char const *)data, size, &count);
+
+			if (count || error)
+			{
+				data += count;
+				size -= count;
+				continue;
+			}
+		}
+
+		/* Anything else is decoded by chunks */
+		decoding = decodeUtf8(self, (unsigned char const *)data, size,
+			chunk, &count, &consumed);
+		error = feedChars(self, chunk, count);
+
+		if (!error)
+			/* Invalid UTF-8 sequence */
+			error = decoding;
+
+		data += consumed;
+		size -= consumed;
+	}
 
 	return error;
 }
 
 int QxJsonParser_end(QxJsonParser *self, QxJsonValue **value)
 {
+	int const building = self && self->handler == &domHandler;
 	int error;
 
-	if (!self || !value)
+	if (!self || (building && !value))
 		/* Invalid arguments */
 		return -1;
 
-	error = self->tokenStep->endOfStream(self);
+	if (self->utf8Pending)
+		/* Truncated UTF-8 sequence */
+		return -1;
+
+	error = endToken(self);
 
 	if (error != 0)
 	{
@@ -249,1003 +513,1168 @@ int QxJsonParser_end(QxJsonParser *self, QxJsonValue **value)
 		return error;
 	}
 
-	if (!self->head.value || self->head.next)
+	if (self->syntaxState != QxJsonSyntaxValue)
 	{
 		/* Value is not ready */
 		return -1;
 	}
 
-	*value = self->head.value;
-	self->head.value = NULL;
-	self->syntaxStep = &stepVoid;
+	if (value)
+		*value = building ? self->root : NULL;
+
+	QxJsonKeyCache_clear(&self->keys);
+	self->root = NULL;
+	self->memory.arena = NULL; /* Owned by the root value */
+	self->syntaxState = QxJsonSyntaxVoid;
+	bufferShrink(self, No);
 	return 0;
 }
 
-/* Private implementations */
+/* Private API */
 
-static int feedAfterVoid(QxJsonParser *self)
+QxJsonAllocator const *QxJsonParser_allocator(QxJsonParser const *self)
 {
-	self->head.value = createValueFromToken(self);
-
-	if (!self->head.value)
-		/* Unexpected token */
-		return -1;
-
-	if (self->syntaxStep == &stepVoid)
-		self->syntaxStep = &stepValue;
-
-	return 0;
+	return self->memory.allocator;
 }
 
-static int feedAfterValue(QxJsonParser *self)
-{
-	(void)self;
-	/* A root value is ready.
-	 * Get it using QxJsonParser_end().
-	 */
-	return -1;
-}
+/* Private implementations */
 
-static int feedAfterArrayBegin(QxJsonParser *self)
+static int pushStackItem(QxJsonParser *self, unsigned char kind)
 {
-	QxJsonValue *array;
-	QxJsonValue *value;
-
-	switch (self->tokenType)
-	{
-	case QxJsonTokenEndArray:
-		popStackItem(self);
-		break;
+	unsigned char *data;
+	size_t alloc;
 
-	default:
-		array = self->head.next->value;
-		assert(QX_JSON_IS_ARRAY(array));
-		value = createValueFromToken(self);
+	if (self->nestingSize == self->maxDepth && self->maxDepth)
+		/* Too deeply nested */
+		return -1;
 
-		if (!value)
-			/* Unexpected token */
-			return -1;
+	if (self->nestingSize == self->nestingAlloc)
+	{
+		alloc = self->nestingAlloc ? self->nestingAlloc * 2 : NESTING_MIN_ALLOC;
+		data = (unsigned char *)QxJsonAllocator_realloc(self->memory.allocator,
+			self->nestingData, alloc);
 
-		if (QxJsonValue_arrayAppendNew(array, value) != 0)
-			/* Failed to append a value to the array */
+		if (!data)
+			/* Memory allocation failed */
 			return -1;
 
-		switch (QxJsonValue_type(value))
-		{
-		case QxJsonValueTypeArray:
-		case QxJsonValueTypeObject:
-			break;
+		self->nestingData = data;
+		self->nestingAlloc = alloc;
+	}
 
-		default:
-			self->syntaxStep = &stepArrayValue;
-		}
+	self->nestingData[self->nestingSize] = kind;
+	++self->nestingSize;
 
-		break;
+	if (kind == NESTING_ARRAY)
+	{
+		self->syntaxState = QxJsonSyntaxArrayBegin;
+		return self->handler->beginArray(self->handlerPtr);
 	}
 
-	return 0;
+	self->syntaxState = QxJsonSyntaxObjectBegin;
+	return self->handler->beginObject(self->handlerPtr);
 }
 
-static int feedAfterArrayValue(QxJsonParser *self)
+static int popStackItem(QxJsonParser *self)
 {
-	switch (self->tokenType)
-	{
-	case QxJsonTokenEndArray:
-		popStackItem(self);
-		break;
+	unsigned char kind;
 
-	case QxJsonTokenValuesSeparator:
-		self->syntaxStep = &stepArrayComma;
-		break;
+	assert(self->nestingSize > 0);
+	--self->nestingSize;
+	kind = self->nestingData[self->nestingSize];
 
-	default:
-		/* Unexpected token */
-		return -1;
-	}
+	if (!self->nestingSize)
+		self->syntaxState = QxJsonSyntaxValue;
+	else if (self->nestingData[self->nestingSize - 1] == NESTING_ARRAY)
+		self->syntaxState = QxJsonSyntaxArrayValue;
+	else
+		self->syntaxState = QxJsonSyntaxObjectValue;
 
-	return 0;
+	if (kind == NESTING_ARRAY)
+		return self->handler->endArray(self->handlerPtr);
+
+	return self->handler->endObject(self->handlerPtr);
 }
 
-static int feedAfterArrayComma(QxJsonParser *self)
+static int raiseInteger(QxJsonParser *self, uint64_t magnitude)
 {
-	QxJsonValue *array = self->head.next->value;
-	QxJsonValue *const value = createValueFromToken(self);
+	int64_t value;
 
-	if (!value)
-		/* Unexpected token */
-		return -1;
+	if (self->number.negative)
+	{
+		/* Avoid overflowing with INT64_MIN */
+		value = -(int64_t)(magnitude - 1) - 1;
 
-	assert(QX_JSON_IS_ARRAY(array));
+		if (self->handler->integer)
+			return self->handler->integer(self->handlerPtr, value);
 
-	if (QxJsonValue_arrayAppendNew(array, value) != 0)
-		/* Failed to append a value to the array */
-		return -1;
+		return self->handler->number(self->handlerPtr, (double)value);
+	}
 
-	switch (QxJsonValue_type(value))
+	if (magnitude <= INT64_MAX)
 	{
-	case QxJsonValueTypeArray:
-	case QxJsonValueTypeObject:
-		break;
-
-	default:
-		self->syntaxStep = &stepArrayValue;
+		if (self->handler->integer)
+			return self->handler->integer(self->handlerPtr, (int64_t)magnitude);
 	}
+	else if (self->handler->unsignedInteger)
+		return self->handler->unsignedInteger(self->handlerPtr, magnitude);
 
-	return 0;
+	return self->handler->number(self->handlerPtr, (double)magnitude);
 }
 
-static int feedAfterObjectBegin(QxJsonParser *self)
+/* Raise the event of a value, then expect what follows it */
+static int raiseValue(QxJsonParser *self, QxJsonTokenType type,
+	QxJsonSyntaxState next)
 {
-	switch (self->tokenType)
+	uint64_t magnitude;
+	double number;
+	int error;
+
+	switch (type)
 	{
 	case QxJsonTokenString:
-		self->key = QxJsonValue_stringNew(self->bufferData, self->bufferSize);
+		error = self->handler->string(self->handlerPtr,
+			bufferString(self), self->bufferSize);
+		break;
 
-		if (!self->key)
-			/* Failed to create string value */
-			return -1;
+	case QxJsonTokenNumber:
+		if ((self->flags & QX_JSON_PARSER_LAZY_NUMBERS) && self->handler == &domHandler)
+			error = domNumberText(self);
+		else if (QxJsonNumber_toInteger(&self->number,
+				self->bufferData, self->bufferSize, &magnitude) == 0)
+			error = raiseInteger(self, magnitude);
+		else if (QxJsonNumber_toDouble(&self->number, self->memory.allocator,
+				self->bufferData, self->bufferSize, &number) != 0)
+			/* Out of memory */
+			error = -1;
+		else
+			error = self->handler->number(self->handlerPtr, number);
+
+		break;
+
+	case QxJsonTokenFalse:
+		error = self->handler->boolean(self->handlerPtr, 0);
+		break;
 
-		self->syntaxStep = &stepObjectKey;
+	case QxJsonTokenTrue:
+		error = self->handler->boolean(self->handlerPtr, 1);
 		break;
 
-	case QxJsonTokenEndObject:
-		popStackItem(self);
+	case QxJsonTokenNull:
+		error = self->handler->null(self->handlerPtr);
 		break;
 
+	case QxJsonTokenBeginArray:
+		return pushStackItem(self, NESTING_ARRAY);
+
+	case QxJsonTokenBeginObject:
+		return pushStackItem(self, NESTING_OBJECT);
+
 	default:
 		/* Unexpected token */
 		return -1;
 	}
 
-	return 0;
+	if (!error)
+		self->syntaxState = next;
+
+	return error;
 }
 
-static int feedAfterObjectKey(QxJsonParser *self)
+/* Document building */
+
+/* Whether the next value is selected by the projection, and its node */
+static int domSelect(QxJsonParser *self, QxJsonProjectionNode const **node)
 {
-	if (self->tokenType != QxJsonTokenNameValueSeparator)
+	StackValue *const level = stackTop(self);
+	QxJsonProjectionNode const *match;
+
+	if (!level)
+		match = self->projection ? QxJsonProjection_root(self->projection) : NULL;
+	else if (!level->node)
+		/* Within a selected value */
+		match = NULL;
+	else if (QX_JSON_IS_OBJECT(level->value))
+		/* Members have been filtered by their key */
+		match = self->match;
+	else
 	{
-		/* Unexpected token */
-		return -1;
+		match = QxJsonProjection_matchIndex(level->node, level->index);
+		++level->index;
+
+		if (!match)
+			return No;
+
+		if (QxJsonProjection_matchAll(match))
+			match = NULL;
 	}
 
-	self->syntaxStep = &stepObjectColon;
-	return 0;
+	*node = match;
+	return Yes;
 }
 
-static int feedAfterObjectColon(QxJsonParser *self)
+/* Whether the next scalar is selected: the paths leading to deeper values
+ * do not select it. The root is always kept. */
+static int domSelectScalar(QxJsonParser *self)
 {
-	QxJsonValue *object, *value;
+	QxJsonProjectionNode const *node;
 
-	object = self->head.next->value;
-	value = createValueFromToken(self);
+	if (!domSelect(self, &node))
+		return No;
+
+	if (!node || !self->stackSize || QxJsonProjection_matchLeaf(node))
+		return Yes;
+
+	if (self->key)
+	{
+		/* The member is dropped */
+		QxJsonValue_release(self->key);
+		self->key = NULL;
+	}
+
+	return No;
+}
+
+static int domInsert(QxJsonParser *self, QxJsonValue *value)
+{
+	QxJsonValue *container;
+	int error;
 
 	if (!value)
-		/* Unexpected token */
+		/* Allocation error */
 		return -1;
 
-	assert(self->key != NULL);
+	if (!self->stackSize)
+	{
+		/* Root value */
+		assert(self->root == NULL);
+		self->root = value;
+		return 0;
+	}
 
-	if (QxJsonValue_objectSet(object, self->key, value) != 0)
-		/* Failed to add the new key/value pair */
-		return -1;
+	container = stackTop(self)->value;
 
-	QxJsonValue_release(self->key);
-	self->key = NULL;
-	QxJsonValue_release(value);
+	if (QX_JSON_IS_ARRAY(container))
+	{
+		error = QxJsonValue_arrayAppendNew(container, value);
+	}
+	else
+	{
+		assert(self->key != NULL);
+		error = QxJsonValue_objectSet(container, self->key, value);
+		QxJsonValue_release(self->key);
+		self->key = NULL;
+		QxJsonValue_release(value);
+		return error;
+	}
 
-	if (self->syntaxStep == &stepObjectColon)
-		self->syntaxStep = &stepObjectValue;
+	if (error)
+		/* Failed to insert the value */
+		QxJsonValue_release(value);
 
-	return 0;
+	return error;
 }
 
-static int feedAfterObjectValue(QxJsonParser *self)
+static int domPush(QxJsonParser *self, int array)
 {
-	switch (self->tokenType)
+	QxJsonProjectionNode const *node;
+	QxJsonValue *container;
+	StackValue *data;
+	size_t alloc;
+
+	if (!domSelect(self, &node))
 	{
-	case QxJsonTokenValuesSeparator:
-		self->syntaxStep = &stepObjectComma;
-		break;
+		/* Not selected by the projection */
+		self->skipped = Yes;
+		return QxJsonParser_skip(self);
+	}
 
-	case QxJsonTokenEndObject:
-		popStackItem(self);
-		break;
+	if (!self->stackSize && (self->flags & QX_JSON_PARSER_ARENA))
+	{
+		/* The root container owns the arena */
+		assert(self->memory.arena == NULL);
+		self->memory.arena = QxJsonArena_new(self->memory.allocator);
 
-	default:
-		/* Unexpected token */
-		return -1;
+		if (!self->memory.arena)
+			/* Allocation error */
+			return -1;
 	}
 
-	return 0;
-}
+	if (self->stackSize == self->stackAlloc)
+	{
+		alloc = self->stackAlloc ? self->stackAlloc * 2 : STACK_MIN_ALLOC;
+		data = (StackValue *)QxJsonAllocator_realloc(self->memory.allocator,
+			self->stackData, alloc * sizeof(StackValue));
 
-static int feedAfterObjectComma(QxJsonParser *self)
-{
-	if (self->tokenType != QxJsonTokenString)
-		/* Unexpected token */
-		return -1;
+		if (!data)
+			/* Allocation error */
+			return -1;
 
-	assert(self->key == NULL);
-	self->key = QxJsonValue_stringNew(self->bufferData, self->bufferSize);
+		self->stackData = data;
+		self->stackAlloc = alloc;
+	}
 
-	if (!self->key)
-		/* Failed to create the string */
+	if (array)
+		container = QxJsonValue_arrayNewIn(&self->memory);
+	else
+		container = QxJsonValue_objectNewIn(&self->memory);
+
+	if (container && self->memory.arena && !self->stackSize)
+		QxJsonValue_ownArena(container);
+
+	if (domInsert(self, container) != 0)
+		/* Allocation error */
 		return -1;
 
-	self->syntaxStep = &stepObjectKey;
+	data = self->stackData + self->stackSize;
+	data->value = container;
+	data->node = node;
+	data->index = 0;
+	++self->stackSize;
 	return 0;
 }
 
-static int canFeedTokenAfterVoid(QxJsonTokenType type)
+static int domPop(QxJsonParser *self)
 {
-	switch (type)
+	if (self->skipped)
 	{
-	case QxJsonTokenValuesSeparator:
-	case QxJsonTokenEndArray:
-	case QxJsonTokenNameValueSeparator:
-	case QxJsonTokenEndObject:
-		return No;
-
-	default:
-		return Yes;
+		/* The container was not pushed */
+		self->skipped = No;
+		return 0;
 	}
+
+	assert(self->stackSize > 0);
+	--self->stackSize;
+	return 0;
 }
 
-static int canFeedTokenAfterValue(QxJsonTokenType type)
+static int domBeginArray(void *ptr)
 {
-	switch (type)
-	{
-	case QxJsonTokenValuesSeparator:
-	case QxJsonTokenEndArray:
-	case QxJsonTokenNameValueSeparator:
-	case QxJsonTokenEndObject:
-		return Yes;
+	return domPush((QxJsonParser *)ptr, Yes);
+}
 
-	default:
-		return No;
-	}
+static int domEndArray(void *ptr)
+{
+	return domPop((QxJsonParser *)ptr);
 }
 
-static int canFeedTokenAfterArrayBegin(QxJsonTokenType type)
+static int domBeginObject(void *ptr)
 {
-	switch (type)
-	{
-	case QxJsonTokenValuesSeparator:
-	case QxJsonTokenNameValueSeparator:
-	case QxJsonTokenEndObject:
-		return No;
+	return domPush((QxJsonParser *)ptr, No);
+}
 
-	default:
-		return Yes;
-	}
+static int domEndObject(void *ptr)
+{
+	return domPop((QxJsonParser *)ptr);
 }
 
-static int canFeedTokenAfterArrayValue(QxJsonTokenType type)
+static int domKey(void *ptr, wchar_t const *data, size_t size)
 {
-	switch (type)
+	QxJsonParser *const self = (QxJsonParser *)ptr;
+	StackValue *const level = stackTop(self);
+	QxJsonProjectionNode const *match;
+
+	if (level->node)
 	{
-	case QxJsonTokenValuesSeparator:
-	case QxJsonTokenEndArray:
-		return Yes;
+		match = QxJsonProjection_matchKey(level->node, data, size);
 
-	default:
-		return No;
+		if (!match)
+			/* Not selected by the projection */
+			return QxJsonParser_skip(self);
+
+		self->match = QxJsonProjection_matchAll(match) ? NULL : match;
 	}
 
-}
+	assert(self->key == NULL);
+	self->key = QxJsonKeyCache_get(&self->keys, &self->memory, data, size,
+		self->flags & QX_JSON_PARSER_UTF8_STRINGS);
 
-static int canFeedTokenAfterArrayComma(QxJsonTokenType type)
-{
-	switch (type)
-	{
-	case QxJsonTokenValuesSeparator:
-	case QxJsonTokenEndArray:
-	case QxJsonTokenNameValueSeparator:
-	case QxJsonTokenEndObject:
-		return No;
+	if (!self->key)
+		/* Failed to create the string */
+		return -1;
 
-	default:
-		return Yes;
-	}
+	return 0;
 }
 
-static int canFeedTokenAfterObjectBegin(QxJsonTokenType type)
+static int domString(void *ptr, wchar_t const *data, size_t size)
 {
-	switch (type)
-	{
-	case QxJsonTokenString:
-	case QxJsonTokenEndObject:
-		return Yes;
+	QxJsonParser *const self = (QxJsonParser *)ptr;
 
-	default:
-		return No;
-	}
-}
+	if (!domSelectScalar(self))
+		return 0;
 
-static int canFeedTokenAfterObjectKey(QxJsonTokenType type)
-{
-	return type == QxJsonTokenNameValueSeparator;
+	if (self->flags & QX_JSON_PARSER_UTF8_STRINGS)
+		return domInsert(self, QxJsonValue_stringNewAsUtf8In(&self->memory,
+			data, size));
+
+	return domInsert(self, QxJsonValue_stringNewIn(&self->memory, data, size));
 }
 
-static int canFeedTokenAfterObjectColon(QxJsonTokenType type)
+static int domNumber(void *ptr, double value)
 {
-	switch (type)
-	{
-	case QxJsonTokenValuesSeparator:
-	case QxJsonTokenEndArray:
-	case QxJsonTokenNameValueSeparator:
-	case QxJsonTokenEndObject:
-		return No;
+	QxJsonParser *const self = (QxJsonParser *)ptr;
 
-	default:
-		return Yes;
-	}
+	if (!domSelectScalar(self))
+		return 0;
 
+	return domInsert(self, QxJsonValue_numberNewIn(&self->memory, value));
 }
 
-static int canFeedTokenAfterObjectValue(QxJsonTokenType type)
+static int domNumberText(QxJsonParser *self)
 {
-	switch (type)
-	{
-	case QxJsonTokenValuesSeparator:
-	case QxJsonTokenEndObject:
-		return Yes;
+	if (!domSelectScalar(self))
+		return 0;
 
-	default:
-		return No;
-	}
+	return domInsert(self, QxJsonValue_numberNewTextIn(&self->memory,
+		self->bufferData, self->bufferSize));
 }
 
-static int canFeedTokenAfterObjectComma(QxJsonTokenType type)
+static int domInteger(void *ptr, int64_t value)
 {
-	return type == QxJsonTokenString;
-}
+	QxJsonParser *const self = (QxJsonParser *)ptr;
 
-static void popStackItem(QxJsonParser *self)
-{
-	StackValue *item = self->head.next;
-	self->head.next = item->next;
-	free(item);
+	if (!domSelectScalar(self))
+		return 0;
 
-	if (self->head.next)
-	{
-		if (QX_JSON_IS_ARRAY(self->head.next->value))
-		{
-			self->syntaxStep = &stepArrayValue;
-		}
-		else
-		{
-			assert(QX_JSON_IS_OBJECT(self->head.next->value));
-			self->syntaxStep = &stepObjectValue;
-		}
-	}
-	else
-	{
-		self->syntaxStep = &stepValue;
-	}
+	return domInsert(self, QxJsonValue_numberNewInt64In(&self->memory, value));
 }
 
-static QxJsonValue *createValueFromToken(QxJsonParser *self)
+static int domUnsignedInteger(void *ptr, uint64_t value)
 {
-	StackValue *item = NULL;
-	double number;
-	wchar_t *endptr;
+	QxJsonParser *const self = (QxJsonParser *)ptr;
 
-	switch (self->tokenType)
-	{
-	case QxJsonTokenString:
-		return QxJsonValue_stringNew(self->bufferData, self->bufferSize);
+	if (!domSelectScalar(self))
+		return 0;
 
-	case QxJsonTokenNumber:
-		endptr = NULL;
-		number = wcstod(self->bufferData, &endptr);
+	return domInsert(self, QxJsonValue_numberNewUint64In(&self->memory, value));
+}
 
-		if (endptr == self->bufferData + self->bufferSize)
-			return QxJsonValue_numberNew(number);
+static int domBoolean(void *ptr, int value)
+{
+	QxJsonParser *const self = (QxJsonParser *)ptr;
 
-		break;
+	if (!domSelectScalar(self))
+		return 0;
 
-	case QxJsonTokenFalse:
-		return QxJsonValue_falseNew();
+	if (value)
+		return domInsert(self, QxJsonValue_trueNewIn(&self->memory));
 
-	case QxJsonTokenTrue:
-		return QxJsonValue_trueNew();
+	return domInsert(self, QxJsonValue_falseNewIn(&self->memory));
+}
 
-	case QxJsonTokenNull:
-		return QxJsonValue_nullNew();
+static int domNull(void *ptr)
+{
+	QxJsonParser *const self = (QxJsonParser *)ptr;
 
-	case QxJsonTokenBeginArray:
+	if (!domSelectScalar(self))
+		return 0;
 
-		item = StackValue_alloc();
+	return domInsert(self, QxJsonValue_nullNewIn(&self->memory));
+}
 
-		if (item)
-		{
-			item->value = QxJsonValue_arrayNew();
+static void domClear(QxJsonParser *self)
+{
+	if (self->key)
+	{
+		QxJsonValue_release(self->key);
+		self->key = NULL;
+	}
 
-			if (item->value)
-				self->syntaxStep = &stepArrayBegin;
-		}
+	/* Before the arena keys go away */
+	QxJsonKeyCache_clear(&self->keys);
 
-		/* Allocation error */
-		break;
+	if (self->root)
+		/* Frees the arena too, if any */
+		QxJsonValue_release(self->root);
+	else if (self->memory.arena)
+		QxJsonArena_delete(self->memory.arena);
 
-	case QxJsonTokenBeginObject:
+	self->root = NULL;
+	self->memory.arena = NULL;
+	self->skipped = No;
+	self->stackSize = 0;
+}
 
-		item = StackValue_alloc();
+/* The token and syntax levels are fused: a single loop dispatches on the
+ * token state and consumes runs of characters whenever it can. Characters
+ * out of the tokens are classified by a table, and the syntax transitions
+ * are looked up in another one. */
+static int feedChars(QxJsonParser *self, wchar_t const *data, size_t size)
+{
+	wchar_t const *const end = data + size;
+	wchar_t character;
+	size_t count;
+	int value;
+	int error = 0;
+
+	while (data != end && !error)
+	{
+		character = *data;
 
-		if (item)
+		switch (self->tokenState)
 		{
-			item->value = QxJsonValue_objectNew();
+		case QxJsonStateDefault:
+			if (classOf(character) == CLASS_SPACE)
+			{
+				/* White spaces between tokens are skipped by runs */
+				data += self->scanner->wideSpace(data, (size_t)(end - data));
+				continue;
+			}
 
-			if (item->value)
-				self->syntaxStep = &stepObjectBegin;
-		}
+			error = beginToken(self, data, (size_t)(end - data), &count);
+			data += count;
+			continue;
 
-		/* Allocation error */
-		break;
-
-	default:
-		break;
-	}
+		case QxJsonStateString:
+			/* Plain characters are copied by runs */
+			count = self->scanner->wideString(data, (size_t)(end - data));
 
-	if (item)
-	{
-		if (item->value)
-		{
-			item->next = self->head.next;
-			self->head.next = item;
-			return item->value;
-		}
+			if (count)
+			{
+				error = bufferAppend(self, data, count);
+				data += count;
+				continue;
+			}
 
-		/* Allocation error */
-		free(item);
-	}
+			if (character == L'"')
+				error = raiseToken(self, QxJsonTokenString);
+			else if (character == L'\\')
+				self->tokenState = QxJsonStateEscape;
+			else
+				/* Control characters must be escaped */
+				error = -1;
 
-	return NULL;
-}
+			break;
 
-static int feedDefault(QxJsonParser *self, wchar_t character)
-{
-	assert(self != NULL);
+		case QxJsonStateEscape:
+			switch (character)
+			{
+			case L'"':
+			case L'/':
+			case L'\\':
+				break;
+
+			case L'b': character = L'\b'; break;
+			case L'f': character = L'\f'; break;
+			case L'n': character = L'\n'; break;
+			case L'r': character = L'\r'; break;
+			case L't': character = L'\t'; break;
+
+			case L'u':
+				/* Filled by the next 4 hexadecimal digits */
+				self->tokenState = QxJsonStateUnicode;
+				self->hexaDigits = 0;
+				character = 0;
+				break;
+
+			default:
+				/* Unsupported escaped sequence */
+				return -1;
+			}
 
-	switch (character)
-	{
-	case L'\t':
-	case L'\n':
-	case L'\r':
-	case L' ':
-		/* Ignored white space */
-		return 0;
+			if (self->tokenState == QxJsonStateEscape)
+				self->tokenState = QxJsonStateString;
 
-	case L'"':
-		if (!self->syntaxStep->canFeed(QxJsonTokenString))
-			return -1;
+			error = wcharToBuffer(self, character);
+			break;
 
-		self->tokenStep = &stepString;
-		self->bufferSize = 0;
-		return 0;
+		case QxJsonStateUnicode:
+			if (WITHIN_0_9(character))
+				value = character - L'0';
+			else if (WITHIN_a_f(character))
+				value = character - L'a' + 10;
+			else if (WITHIN_A_F(character))
+				value = character - L'A' + 10;
+			else
+				/* Unexpected character */
+				return -1;
 
-	case L',':
-		if (!self->syntaxStep->canFeed(QxJsonTokenValuesSeparator))
-			return -1;
+			self->bufferData[self->bufferSize - 1] =
+				(wchar_t)(self->bufferData[self->bufferSize - 1] << 4 | value);
 
-		return raiseToken(self, QxJsonTokenValuesSeparator);
+			if (++self->hexaDigits == 4)
+				self->tokenState = QxJsonStateString;
 
-	case L'-':
-		if (!self->syntaxStep->canFeed(QxJsonTokenNumber))
-			return -1;
+			break;
 
-		self->tokenStep = &stepNumberMinus;
-		self->bufferSize = 0;
-		return wcharToBuffer(self, L'-');
+		case QxJsonStateLiteral:
+			/* A literal split between two feeds */
+			if (character != *self->literal)
+				/* Unexpected character */
+				return -1;
 
-	case L'0':
-		if (!self->syntaxStep->canFeed(QxJsonTokenNumber))
-			return -1;
+			if (!*++self->literal)
+				error = raiseToken(self, self->literalType);
 
-		self->tokenStep = &stepNumberZero;
-		self->bufferSize = 0;
-		return wcharToBuffer(self, L'0');
+			break;
 
-	case L':':
-		if (!self->syntaxStep->canFeed(QxJsonTokenNameValueSeparator))
-			return -1;
+		case QxJsonStateNumberExp:
+			if (character == L'-' || character == L'+')
+			{
+				self->number.exponentNegative = character == L'-';
+				self->tokenState = QxJsonStateNumberExpSign;
+				error = wcharToBuffer(self, character);
+				break;
+			}
 
-		return raiseToken(self, QxJsonTokenNameValueSeparator);
+			/* Falls through */
+		case QxJsonStateNumberMinus:
+		case QxJsonStateNumberDot:
+		case QxJsonStateNumberExpSign:
+			if (!WITHIN_0_9(character))
+				/* A digit is expected */
+				return -1;
 
-	case L'[':
-		if (!self->syntaxStep->canFeed(QxJsonTokenBeginArray))
-			return -1;
+			if (character == L'0' && self->tokenState == QxJsonStateNumberMinus)
+			{
+				/* No more digits after a leading zero */
+				self->tokenState = QxJsonStateNumberZero;
+				QxJsonNumber_digit(&self->number, character, 0);
+				error = wcharToBuffer(self, character);
+				break;
+			}
 
-		return raiseToken(self, QxJsonTokenBeginArray);
+			/* The digits are consumed by runs in the next state */
+			if (self->tokenState == QxJsonStateNumberMinus)
+				self->tokenState = QxJsonStateNumberInteger;
+			else if (self->tokenState == QxJsonStateNumberDot)
+				self->tokenState = QxJsonStateNumberFrac;
+			else
+				self->tokenState = QxJsonStateNumberExpInteger;
 
-	case L']':
-		if (!self->syntaxStep->canFeed(QxJsonTokenEndArray))
-			return -1;
+			continue;
 
-		return raiseToken(self, QxJsonTokenEndArray);
+		case QxJsonStateNumberInteger:
+		case QxJsonStateNumberFrac:
+		case QxJsonStateNumberExpInteger:
+			if (WITHIN_0_9(character))
+			{
+				error = numberDigits(self, data, (size_t)(end - data), &count);
+				data += count;
+				continue;
+			}
 
-	case L'f':
-		if (!self->syntaxStep->canFeed(QxJsonTokenFalse))
-			return -1;
+			/* Falls through */
+		case QxJsonStateNumberZero:
+			if (character == L'.' && (self->tokenState == QxJsonStateNumberZero
+					|| self->tokenState == QxJsonStateNumberInteger))
+				self->tokenState = QxJsonStateNumberDot;
+			else if ((character == L'e' || character == L'E')
+					&& self->tokenState != QxJsonStateNumberExpInteger)
+				self->tokenState = QxJsonStateNumberExp;
+			else
+			{
+				/* The number is complete, the character is fed again */
+				error = raiseToken(self, QxJsonTokenNumber);
+				continue;
+			}
 
-		self->tokenStep = &stepF;
-		return 0;
+			error = wcharToBuffer(self, character);
+			break;
 
-	case L'n':
-		if (!self->syntaxStep->canFeed(QxJsonTokenNull))
-			return -1;
+		case QxJsonStateSkip:
+			/* Raw scan of the skipped characters */
+			error = skipChars(self, data, (size_t)(end - data), &count);
+			data += count;
+			continue;
+		}
 
-		self->tokenStep = &stepN;
-		return 0;
+		++data;
+	}
 
-	case L't':
-		if (!self->syntaxStep->canFeed(QxJsonTokenTrue))
-			return -1;
+	return error;
+}
 
-		self->tokenStep = &stepT;
-		return 0;
+/* Start a token from the default state. The count of consumed characters
+ * is 0 when the token state consumes them by runs. */
+static int beginToken(QxJsonParser *self, wchar_t const *data, size_t size,
+	size_t *count)
+{
+	unsigned char const kind = classOf(*data);
+	QxJsonTokenType const type = classTokens[kind];
+	size_t literalSize;
 
-	case L'{':
-		if (!self->syntaxStep->canFeed(QxJsonTokenBeginObject))
-			return -1;
+	*count = 1;
 
-		return raiseToken(self, QxJsonTokenBeginObject);
+	if (kind == CLASS_INVALID)
+		/* Unexpected character */
+		return -1;
 
-	case L'}':
-		if (!self->syntaxStep->canFeed(QxJsonTokenEndObject))
-			return -1;
+	if (syntaxActions[self->syntaxState][type] == ACTION_ERROR)
+		/* Unexpected token */
+		return -1;
 
-		return raiseToken(self, QxJsonTokenEndObject);
+	switch (kind)
+	{
+	case CLASS_QUOTE:
+		self->tokenState = QxJsonStateString;
+		self->bufferSize = 0;
+		return 0;
 
-	default:
+	case CLASS_MINUS:
+	case CLASS_ZERO:
+	case CLASS_DIGIT:
+		self->bufferSize = 0;
+		memset(&self->number, 0, sizeof(QxJsonNumber));
 
-		if (WITHIN_1_9(character))
+		if (kind == CLASS_DIGIT)
 		{
-			if (!self->syntaxStep->canFeed(QxJsonTokenNumber))
-				return -1;
+			self->tokenState = QxJsonStateNumberInteger;
+			*count = 0;
+			return 0;
+		}
 
-			self->tokenStep = &stepNumberInteger;
-			self->bufferSize = 0;
-			return wcharToBuffer(self, character);
+		if (kind == CLASS_MINUS)
+		{
+			self->tokenState = QxJsonStateNumberMinus;
+			self->number.negative = Yes;
+		}
+		else
+		{
+			self->tokenState = QxJsonStateNumberZero;
+			QxJsonNumber_digit(&self->number, *data, 0);
 		}
-	}
 
-	/* Unexpected character */
-	return -1;
-}
+		return wcharToBuffer(self, *data);
 
-static int feedString(QxJsonParser *self, wchar_t character)
-{
-	switch (character)
-	{
-	case L'"': /* End of the string */
-		return raiseToken(self, QxJsonTokenString);
+	case CLASS_FALSE:
+	case CLASS_TRUE:
+	case CLASS_NULL:
+		self->literal = literals[type - QxJsonTokenFalse];
+		literalSize = literalSizes[type - QxJsonTokenFalse];
 
-	case L'\\': /* Escaped sequence */
-		self->tokenStep = &stepStringEscape;
-		break;
+		if (size >= literalSize && !wmemcmp(data, self->literal, literalSize))
+		{
+			/* The whole literal at once */
+			*count = literalSize;
+			return raiseToken(self, type);
+		}
+
+		/* Split between two feeds, or invalid */
+		self->tokenState = QxJsonStateLiteral;
+		self->literalType = type;
+		++self->literal;
+		return 0;
 
 	default:
-		wcharToBuffer(self, character);
+		/* Structural character */
+		return raiseToken(self, type);
 	}
-
-	return 0;
 }
 
-static int feedStringEscape(QxJsonParser *self, wchar_t character)
+/* Append a run of digits to the number */
+static int numberDigits(QxJsonParser *self, wchar_t const *data, size_t size,
+	size_t *count)
 {
-	wchar_t const *const translation =
-		L"\"" L"\""
-		L"/"  L"/"
-		L"\\" L"\\"
-		L"b"  L"\b"
-		L"f"  L"\f"
-		L"r"  L"\r"
-		L"n"  L"\n"
-		L"t"  L"\t";
-	wchar_t const *translationOffset = translation;
-
-	if (character == L'u')
-	{
-		self->tokenStep = &stepStringUnicode;
-		return 0;
-	}
+	int const fraction = self->tokenState == QxJsonStateNumberFrac;
+	size_t index;
 
-	translationOffset = translation;
-
-	while (*translationOffset && (character != *translationOffset))
+	if (self->tokenState == QxJsonStateNumberExpInteger)
 	{
-		translationOffset += 2;
+		for (index = 0; index != size && WITHIN_0_9(data[index]); ++index)
+			QxJsonNumber_exponentDigit(&self->number, data[index]);
 	}
-
-	if (*translationOffset)
+	else
 	{
-		self->tokenStep = &stepString;
-		return wcharToBuffer(self, *(translationOffset + 1));
+		for (index = 0; index != size && WITHIN_0_9(data[index]); ++index)
+			QxJsonNumber_digit(&self->number, data[index], fraction);
 	}
 
-	/* Unsupported escapped sequence */
-	return -1;
+	*count = index;
+	return bufferAppend(self, data, index);
 }
 
-static int hexaDigitToValue(wchar_t digit)
+static int endToken(QxJsonParser *self)
 {
-	if (WITHIN_0_9(digit))
+	switch (self->tokenState)
 	{
-		return digit - L'0';
-	}
+	case QxJsonStateDefault:
+		return 0;
 
-	if (WITHIN_a_f(digit))
-	{
-		return digit - L'a' + 10;
-	}
+	case QxJsonStateNumberZero:
+	case QxJsonStateNumberInteger:
+	case QxJsonStateNumberFrac:
+	case QxJsonStateNumberExpInteger:
+		return raiseToken(self, QxJsonTokenNumber);
 
-	if (WITHIN_A_F(digit))
-	{
-		return digit - L'A' + 10;
+	default:
+		/* Unfinished token */
+		return -1;
 	}
-
-	return -1;
 }
 
-static int feedStringUnicode(QxJsonParser *self, wchar_t character)
+/* Scan skipped characters without buffering them, balancing the brackets
+ * outside of strings. The content of the skipped value is not validated.
+ * The count of consumed characters is 0 only when the character ending a
+ * skipped scalar is reached: it must then be fed again. */
+static int skipChars(QxJsonParser *self, wchar_t const *data, size_t size,
+	size_t *count)
 {
-	int const value = hexaDigitToValue(character);
+	unsigned int flags = self->skipFlags;
+	wchar_t character;
+	size_t index;
+	int delimiter;
+	int error = 0;
 
-	if (value < 0)
+	for (index = 0; index < size; ++index)
 	{
-		/* Unexpected character */
-		return -1;
-	}
+		character = data[index];
 
-	self->tokenStep = &stepStringUnicode0;
-	return wcharToBuffer(self, value << 24);
-}
+		if (flags & SKIP_STRING)
+		{
+			if (flags & SKIP_ESCAPE)
+				flags &= ~SKIP_ESCAPE;
+			else if (character == L'\\')
+				flags |= SKIP_ESCAPE;
+			else if (character == L'"')
+			{
+				flags &= ~SKIP_STRING;
+
+				if (!self->skipDepth)
+				{
+					/* A string value */
+					++index;
+					error = skipDone(self, character);
+					break;
+				}
+			}
 
-static int feedStringUnicode0(QxJsonParser *self, wchar_t character)
-{
-	int const value = hexaDigitToValue(character);
+			continue;
+		}
 
-	if (value < 0)
-	{
-		/* Unexpected character */
-		return -1;
-	}
+		delimiter = No;
 
-	self->tokenStep = &stepStringUnicode1;
-	self->bufferData[self->bufferSize] |= value << 16;
-	return 0;
-}
+		switch (character)
+		{
+		case L'"':
+			flags |= SKIP_STRING | SKIP_STARTED;
+			break;
 
-static int feedStringUnicode1(QxJsonParser *self, wchar_t character)
-{
-	int const value = hexaDigitToValue(character);
+		case L'[':
+		case L'{':
+			flags |= SKIP_STARTED;
+			++self->skipDepth;
+			break;
 
-	if (value < 0)
-	{
-		/* Unexpected character */
-		return -1;
-	}
+		case L']':
+		case L'}':
+			if (!self->skipDepth)
+			{
+				/* Ends the scalar value, or unexpected */
+				delimiter = Yes;
+				break;
+			}
 
-	self->tokenStep = &stepStringUnicode2;
-	self->bufferData[self->bufferSize] |= value << 8;
-	return 0;
-}
+			--self->skipDepth;
 
-static int feedStringUnicode2(QxJsonParser *self, wchar_t character)
-{
-	int const value = hexaDigitToValue(character);
+			if (!self->skipDepth)
+			{
+				/* A container value */
+				self->skipFlags = flags;
+				*count = index + 1;
+				return skipDone(self, character);
+			}
 
-	if (value < 0)
-	{
-		/* Unexpected character */
-		return -1;
-	}
+			break;
 
-	self->tokenStep = &stepString;
-	self->bufferData[self->bufferSize] |= value;
-	return 0;
-}
+		case L',':
+			/* Ends the scalar value, or unexpected */
+			delimiter = !self->skipDepth;
+			break;
 
-static int feedF(QxJsonParser *self, wchar_t character)
-{
-	if (character != L'a')
-	{
-		/* Unexpected character */
-		return -1;
-	}
+		case L'\t':
+		case L'\n':
+		case L'\r':
+		case L' ':
+			/* Ends the scalar value */
+			delimiter = !self->skipDepth && (flags & SKIP_STARTED);
+			break;
 
-	self->tokenStep = &stepFa;
-	return 0;
-}
+		default:
+			flags |= SKIP_STARTED;
+		}
 
-static int feedFa(QxJsonParser *self, wchar_t character)
-{
-	if (character != L'l')
-	{
-		/* Unexpected character */
-		return -1;
-	}
+		if (!delimiter)
+			continue;
 
-	self->tokenStep = &stepFal;
-	return 0;
-}
+		if (!(flags & SKIP_STARTED))
+			/* Missing value */
+			error = -1;
+		else
+		{
+			self->skipFlags = flags;
+			error = skipDone(self, character);
+		}
 
-static int feedFal(QxJsonParser *self, wchar_t character)
-{
-	if (character != L's')
-	{
-		/* Unexpected character */
-		return -1;
+		break;
 	}
 
-	self->tokenStep = &stepFals;
-	return 0;
+	if (self->tokenState == QxJsonStateSkip)
+		self->skipFlags = flags;
+
+	*count = index;
+	return error;
 }
 
-static int feedFals(QxJsonParser *self, wchar_t character)
+static int skipDone(QxJsonParser *self, wchar_t character)
 {
-	if (character != L'e')
-	{
-		/* Unexpected character */
-		return -1;
-	}
+	unsigned char const kind = self->nestingData[self->nestingSize - 1];
 
-	self->tokenStep = &stepDefault;
-	return raiseToken(self, QxJsonTokenFalse);
-}
+	self->tokenState = QxJsonStateDefault;
 
-static int feedN(QxJsonParser *self, wchar_t character)
-{
-	if (character != L'u')
+	if (!(self->skipFlags & SKIP_CONTAINER))
 	{
-		/* Unexpected character */
-		return -1;
+		/* The member value is complete */
+		self->syntaxState = QxJsonSyntaxObjectValue;
+		return 0;
 	}
 
-	self->tokenStep = &stepNu;
-	return 0;
-}
-
-static int feedNu(QxJsonParser *self, wchar_t character)
-{
-	if (character != L'l')
-	{
-		/* Unexpected character */
+	if ((kind == NESTING_ARRAY) != (character == L']'))
+		/* Mismatched brackets */
 		return -1;
-	}
 
-	self->tokenStep = &stepNul;
-	return 0;
+	return popStackItem(self);
 }
 
-static int feedNul(QxJsonParser *self, wchar_t character)
+/* Copy the plain ASCII characters of a string up to the next quote,
+ * backslash or control character */
+static int stringBytes(QxJsonParser *self, unsigned char const *data,
+	size_t size, size_t *count)
 {
-	if (character != L'l')
-	{
-		/* Unexpected character */
-		return -1;
-	}
+	unsigned char const *end;
+	wchar_t *output;
 
-	return raiseToken(self, QxJsonTokenNull);
-}
+	*count = self->scanner->utf8String(data, size);
 
-static int feedT(QxJsonParser *self, wchar_t character)
-{
-	if (character != L'r')
-	{
-		/* Unexpected character */
+	if (!*count)
+		return 0;
+
+	if (bufferReserve(self, *count) != 0)
+		/* Out of memory */
 		return -1;
-	}
 
-	self->tokenStep = &stepTr;
-	return 0;
-}
+	output = self->bufferData + self->bufferSize;
+	self->bufferSize += *count;
 
-static int feedTr(QxJsonParser *self, wchar_t character)
-{
-	if (character != L'u')
-	{
-		/* Unexpected character */
-		return -1;
-	}
+	for (end = data + *count; data != end; ++data)
+		*output++ = (wchar_t)*data;
 
-	self->tokenStep = &stepTru;
 	return 0;
 }
 
-static int feedTru(QxJsonParser *self, wchar_t character)
+/* Decode some UTF-8 bytes into a chunk of wide characters. A sequence split
+ * between two feeds is kept in the decoder state. On errors, the characters
+ * decoded so far are still returned. */
+static int decodeUtf8(QxJsonParser *self, unsigned char const *data,
+	size_t size, wchar_t *chunk, size_t *count, size_t *consumed)
 {
-	if (character != L'e')
+	size_t index = 0, length = 0, offset;
+	unsigned long code;
+	uint64_t word;
+	int status = 0;
+
+	/* Keep room for a surrogate pair */
+	while (index != size && length < CHUNK_SIZE - 1)
 	{
-		/* Unexpected character */
-		return -1;
-	}
+		if (!self->utf8Pending && data[index] < 0x80)
+		{
+			if (size - index >= 8 && CHUNK_SIZE - 1 - length >= 8)
+			{
+				memcpy(&word, data + index, 8);
+
+				if (!(word & UINT64_C(0x8080808080808080)))
+				{
+					/* 8 ASCII characters at once */
+					for (offset = 0; offset != 8; ++offset)
+						chunk[length + offset] = (wchar_t)data[index + offset];
+
+					index += 8;
+					length += 8;
+					continue;
+				}
+			}
 
-	return raiseToken(self, QxJsonTokenTrue);
-}
+			chunk[length++] = (wchar_t)data[index++];
+			continue;
+		}
 
-static int feedNumberMinus(QxJsonParser *self, wchar_t character)
-{
-	/* Unexpected character */
-	int error = -1;
+		status = decodeUtf8Byte(self, data[index++]);
 
-	if (WITHIN_0_9(character))
-	{
-		error = wcharToBuffer(self, character);
-	}
+		if (status < 0)
+			break;
 
-	if (error == 0)
-	{
-		if (character == L'0')
-		{
-			self->tokenStep = &stepNumberZero;
-		}
-		else
+		if (!status)
+			/* Wait for the next continuation byte */
+			continue;
+
+		code = self->utf8Code;
+
+#if WCHAR_MAX < 0x10FFFF
+		if (code >= 0x10000)
 		{
-			self->tokenStep = &stepNumberInteger;
+			/* Encode as an UTF-16 surrogate pair */
+			code -= 0x10000;
+			chunk[length++] = (wchar_t)(0xD800 | (code >> 10));
+			code = 0xDC00 | (code & 0x3FF);
 		}
+#endif
+
+		chunk[length++] = (wchar_t)code;
 	}
 
-	return error;
+	*count = length;
+	*consumed = index;
+	return status < 0 ? -1 : 0;
 }
 
-static int feedNumberZero(QxJsonParser *self, wchar_t character)
+/* Returns 1 when a code point is decoded, 0 when more bytes are expected */
+static int decodeUtf8Byte(QxJsonParser *self, unsigned char byte)
 {
-	int error;
+	unsigned long code;
 
-	if (character == L'.')
+	if (!self->utf8Pending)
 	{
-		wcharToBuffer(self, L'.');
-		self->tokenStep = &stepNumberDot;
+		/* Leading byte */
+		if (IN_RANGE(byte, 0xC2, 0xDF))
+		{
+			self->utf8Code = byte & 0x1F;
+			self->utf8Min = 0x80;
+			self->utf8Pending = 1;
+		}
+		else if (IN_RANGE(byte, 0xE0, 0xEF))
+		{
+			self->utf8Code = byte & 0x0F;
+			self->utf8Min = 0x800;
+			self->utf8Pending = 2;
+		}
+		else if (IN_RANGE(byte, 0xF0, 0xF4))
+		{
+			self->utf8Code = byte & 0x07;
+			self->utf8Min = 0x10000;
+			self->utf8Pending = 3;
+		}
+		else
+		{
+			/* Invalid leading byte */
+			return -1;
+		}
+
 		return 0;
 	}
 
-	if ((character == L'e') || (character == L'E'))
+	if ((byte & 0xC0) != 0x80)
 	{
-		wcharToBuffer(self, character);
-		self->tokenStep = &stepNumberExp;
-		return 0;
+		/* Continuation byte expected */
+		self->utf8Pending = 0;
+		return -1;
 	}
 
-	/* Maybe a new token */
-	error = endNumber(self);
-	assert(self->tokenStep == &stepDefault);
-	return error ? error : feedDefault(self, character);
-}
+	self->utf8Code = (self->utf8Code << 6) | (byte & 0x3F);
 
-static int feedNumberInteger(QxJsonParser *self, wchar_t character)
-{
-	if (WITHIN_0_9(character))
-	{
-		wcharToBuffer(self, character);
+	if (--self->utf8Pending)
+		/* Wait for the next continuation byte */
 		return 0;
-	}
 
-	/* Same expectations that after 0 */
-	return feedNumberZero(self, character);
-}
+	code = self->utf8Code;
 
-static int feedNumberDot(QxJsonParser *self, wchar_t character)
-{
-	if (WITHIN_0_9(character))
-	{
-		wcharToBuffer(self, character);
-		self->tokenStep = &stepNumberFrac;
-		return 0;
-	}
+	if (code < self->utf8Min || code > 0x10FFFF || IN_RANGE(code, 0xD800, 0xDFFF))
+		/* Overlong encoding / out of range / surrogate */
+		return -1;
 
-	/* Unexpected character */
-	return -1;
+	return 1;
 }
 
-static int feedNumberFrac(QxJsonParser *self, wchar_t character)
+/* Make room for some more characters in the token buffer. It grows
+ * geometrically, starting from its capacity. */
+static int bufferReserve(QxJsonParser *self, size_t size)
 {
-	int error;
+	wchar_t *dataTmp;
+	size_t alloc;
 
-	if (WITHIN_0_9(character))
-	{
-		wcharToBuffer(self, character);
+	if (self->bufferAlloc - self->bufferSize >= size)
+		/* Enough room */
 		return 0;
-	}
 
-	if ((character == L'e') || (character == L'E'))
-	{
-		wcharToBuffer(self, character);
-		self->tokenStep = &stepNumberExp;
-		return 0;
-	}
+	if (size > (size_t)-1 / sizeof(wchar_t) - self->bufferSize)
+		/* Too large */
+		return -1;
 
-	/* Maybe a new token */
-	error = endNumber(self);
-	assert(self->tokenStep == &stepDefault);
-	return error ? error : feedDefault(self, character);
-}
+	alloc = self->bufferAlloc < self->bufferCapacity
+		? self->bufferCapacity : self->bufferAlloc * 2;
 
-static int feedNumberExp(QxJsonParser *self, wchar_t character)
-{
-	if ((character == L'-') || (character == L'+'))
-	{
-		wcharToBuffer(self, character);
-		self->tokenStep = &stepNumberExpSign;
-		return 0;
-	}
+	if (alloc - self->bufferSize < size || alloc > (size_t)-1 / sizeof(wchar_t))
+		alloc = self->bufferSize + size;
 
-	/* Same expectation as exponent sign */
-	return feedNumberExpSign(self, character);
-}
+	dataTmp = (wchar_t *)QxJsonAllocator_realloc(self->memory.allocator,
+		self->bufferData, alloc * sizeof(wchar_t));
 
-static int feedNumberExpSign(QxJsonParser *self, wchar_t character)
-{
-	if (WITHIN_0_9(character))
-	{
-		wcharToBuffer(self, character);
-		self->tokenStep = &stepNumberExpInteger;
-		return 0;
-	}
+	if (!dataTmp)
+		/* Memory allocation failed */
+		return -1;
 
-	/* Unexpected character */
-	return -1;
+#ifndef NDEBUG
+	/* Be kind with Valgrind */
+	memset(dataTmp + self->bufferAlloc, 0,
+		(alloc - self->bufferAlloc) * sizeof(wchar_t));
+#endif
+	self->bufferData = dataTmp;
+	self->bufferAlloc = alloc;
+	return 0;
 }
 
-static int feedNumberExpInteger(QxJsonParser *self, wchar_t character)
+/* Shrink back a buffer grown beyond its capacity, between two documents.
+ * Unless forced, only once a document did not need it, so that successive
+ * large documents do not grow it again and again. */
+static void bufferShrink(QxJsonParser *self, int force)
 {
-	int error;
+	wchar_t *dataTmp;
+	size_t const peak = self->bufferPeak;
+
+	self->bufferSize = 0;
+	self->bufferPeak = 0;
 
-	if (WITHIN_0_9(character))
+	if (self->bufferAlloc <= self->bufferCapacity)
+		return;
+
+	if (!force && peak > self->bufferAlloc / 4)
+		/* Still useful */
+		return;
+
+	if (!self->bufferCapacity)
 	{
-		wcharToBuffer(self, character);
-		self->tokenStep = &stepNumberExpInteger;
-		return 0;
+		QxJsonAllocator_free(self->memory.allocator, self->bufferData);
+		self->bufferData = NULL;
+		self->bufferAlloc = 0;
+		return;
 	}
 
-	/* Maybe a new token */
-	error = endNumber(self);
-	assert(self->tokenStep == &stepDefault);
-	return error ? error : feedDefault(self, character);
-}
+	dataTmp = (wchar_t *)QxJsonAllocator_realloc(self->memory.allocator,
+		self->bufferData, self->bufferCapacity * sizeof(wchar_t));
 
-static int endDefault(QxJsonParser *self)
-{
-	(void)self;
-	return 0;
-}
+	if (!dataTmp)
+		/* Kept as is */
+		return;
 
-static int endUnexpected(QxJsonParser *self)
-{
-	(void)self;
-	return -1;
+	self->bufferData = dataTmp;
+	self->bufferAlloc = self->bufferCapacity;
 }
 
-static int endNumber(QxJsonParser *self)
+static int bufferAppend(QxJsonParser *self, wchar_t const *data, size_t size)
 {
-	return raiseToken(self, QxJsonTokenNumber);
+	if (bufferReserve(self, size) != 0)
+		/* Memory allocation failed */
+		return -1;
+
+	memcpy(self->bufferData + self->bufferSize, data, size * sizeof(wchar_t));
+	self->bufferSize += size;
+	return 0;
 }
 
 static int wcharToBuffer(QxJsonParser *self, wchar_t character)
 {
-	wchar_t *dataTmp;
-
-	if (self->bufferAlloc == self->bufferSize)
-	{
-		self->bufferAlloc += 512;
-		dataTmp = (wchar_t *)realloc(self->bufferData,
-			self->bufferAlloc * sizeof(wchar_t));
-
-		if (!dataTmp)
-		{
-			/* Memory allocation failed */
-			self->bufferAlloc -= 512;
-			return -1;
-		}
-
-#ifndef NDEBUG
-		/* Be kind with Valgrind */
-		memset(dataTmp + (self->bufferAlloc - 512) * sizeof(wchar_t), 0, 512);
-#endif
-		self->bufferData = dataTmp;
-	}
+	if (self->bufferAlloc == self->bufferSize && bufferReserve(self, 1) != 0)
+		/* Memory allocation failed */
+		return -1;
 
 	self->bufferData[self->bufferSize] = character;
 	++self->bufferSize;
@@ -1256,11 +1685,13 @@ static int raiseToken(QxJsonParser *self, QxJsonTokenType type)
 {
 	int error;
 
-	self->tokenStep = &stepDefault;
-	self->tokenType = type;
+	self->tokenState = QxJsonStateDefault;
 
-	if (self->bufferSize)
+	if ((type == QxJsonTokenString || type == QxJsonTokenNumber) && self->bufferSize)
 	{
+		if (self->bufferSize > self->bufferPeak)
+			self->bufferPeak = self->bufferSize;
+
 		/* Add a trailing nul character */
 		error = wcharToBuffer(self, L'\0');
 
@@ -1273,5 +1704,48 @@ static int raiseToken(QxJsonParser *self, QxJsonTokenType type)
 		--self->bufferSize;
 	}
 
-	return (*self->syntaxStep->feed)(self);
+	switch (syntaxActions[self->syntaxState][type])
+	{
+	case ACTION_ROOT:
+		return raiseValue(self, type, QxJsonSyntaxValue);
+
+	case ACTION_ITEM:
+		return raiseValue(self, type, QxJsonSyntaxArrayValue);
+
+	case ACTION_MEMBER:
+		return raiseValue(self, type, QxJsonSyntaxObjectValue);
+
+	case ACTION_KEY:
+		self->syntaxState = QxJsonSyntaxObjectKey;
+		return self->handler->key(self->handlerPtr,
+			bufferString(self), self->bufferSize);
+
+	case ACTION_COLON:
+		self->syntaxState = QxJsonSyntaxObjectColon;
+
+		if (self->skipFlags & SKIP_PENDING)
+		{
+			/* The value of the member is not wanted */
+			self->tokenState = QxJsonStateSkip;
+			self->skipFlags = 0;
+			self->skipDepth = 0;
+		}
+
+		return 0;
+
+	case ACTION_ITEM_COMMA:
+		self->syntaxState = QxJsonSyntaxArrayComma;
+		return 0;
+
+	case ACTION_MEMBER_COMMA:
+		self->syntaxState = QxJsonSyntaxObjectComma;
+		return 0;
+
+	case ACTION_END:
+		return popStackItem(self);
+
+	default:
+		/* Unexpected token */
+		return -1;
+	}
 }
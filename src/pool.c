@@ -0,0 +1,140 @@
+/**
+ * @file pool.c
+ * @brief Source file of the per-thread pools of parsers.
+ * @author Romain DEOUX
+ */
+
+#include <pthread.h>
+#include <string.h>
+
+#include "../include/qx.json.parser.h"
+#include "qx.json.private.h"
+
+/* Private structure */
+
+/* Idle parsers kept by each thread */
+#define POOL_SIZE 4
+
+typedef struct Pool
+{
+	QxJsonAllocator const *allocator;
+	QxJsonParser *parsers[POOL_SIZE];
+	size_t size;
+} Pool;
+
+/* Private functions */
+
+static Pool *poolGet(int create);
+static void poolInit(void);
+static void poolDelete(void *ptr);
+
+/* Private variables */
+
+static pthread_once_t poolOnce = PTHREAD_ONCE_INIT;
+static pthread_key_t poolKey;
+static int poolReady = 0;
+
+/* Public implementations */
+
+QxJsonParser *QxJsonParser_acquire(void)
+{
+	Pool *const pool = poolGet(0);
+	QxJsonParser *parser;
+
+	while (pool && pool->size)
+	{
+		parser = pool->parsers[--pool->size];
+
+		if (QxJsonParser_allocator(parser) == QxJson_allocator())
+			return parser;
+
+		/* Pooled before the default allocator changed */
+		QxJsonParser_release(parser);
+	}
+
+	return QxJsonParser_new();
+}
+
+void QxJsonParser_recycle(QxJsonParser *self)
+{
+	Pool *pool;
+
+	if (!self)
+		return;
+
+	if (QxJsonParser_allocator(self) != QxJson_allocator())
+	{
+		/* Not a parser with the default settings */
+		QxJsonParser_release(self);
+		return;
+	}
+
+	/* Cannot fail once reset */
+	QxJsonParser_reset(self);
+	QxJsonParser_setFlags(self, 0);
+	QxJsonParser_setBufferCapacity(self, QX_JSON_BUFFER_CAPACITY);
+	QxJsonParser_setMaxDepth(self, QX_JSON_MAX_DEPTH);
+	QxJsonParser_setHandler(self, NULL, NULL);
+	QxJsonParser_setProjection(self, NULL);
+
+	pool = poolGet(1);
+
+	if (!pool || pool->size == POOL_SIZE)
+		/* No room */
+		QxJsonParser_release(self);
+	else
+		pool->parsers[pool->size++] = self;
+}
+
+/* Private implementations */
+
+static Pool *poolGet(int create)
+{
+	QxJsonAllocator const *allocator;
+	Pool *pool;
+
+	pthread_once(&poolOnce, &poolInit);
+
+	if (!poolReady)
+		/* No thread-local storage */
+		return NULL;
+
+	pool = (Pool *)pthread_getspecific(poolKey);
+
+	if (pool || !create)
+		return pool;
+
+	allocator = QxJson_allocator();
+	pool = (Pool *)QxJsonAllocator_alloc(allocator, sizeof(Pool));
+
+	if (!pool)
+		/* Memory allocation failed */
+		return NULL;
+
+	memset(pool, 0, sizeof(Pool));
+	pool->allocator = allocator;
+
+	if (pthread_setspecific(poolKey, pool) != 0)
+	{
+		QxJsonAllocator_free(allocator, pool);
+		return NULL;
+	}
+
+	return pool;
+}
+
+static void poolInit(void)
+{
+	poolReady = pthread_key_create(&poolKey, &poolDelete) == 0;
+}
+
+/* Called when a thread exits */
+static void poolDelete(void *ptr)
+{
+	Pool *const pool = (Pool *)ptr;
+
+	while (pool->size)
+		QxJsonParser_release(pool->parsers[--pool->size]);
+
+	QxJsonAllocator_free(pool->allocator, pool);
+}
@@ -0,0 +1,322 @@
+/**
+ * @file projection.c
+ * @brief Source file of the QxJsonProjection class.
+ * @author Romain DEOUX
+ */
+
+#include <string.h>
+#include <wchar.h>
+
+#include "../include/qx.json.projection.h"
+#include "qx.json.private.h"
+
+/* Private structure */
+
+/* A reference token of the selected paths */
+struct QxJsonProjectionNode
+{
+	wchar_t *token;     /* Unescaped, NULL for the root and the wildcard */
+	size_t size;
+	size_t index;       /* Array index, NO_INDEX if the token is not one */
+	int wildcard;
+	int all;            /* The whole value is selected */
+	QxJsonProjectionNode *child;
+	QxJsonProjectionNode *next;
+};
+
+struct QxJsonProjection
+{
+	QxJsonAllocator const *allocator;
+	QxJsonProjectionNode root;
+};
+
+#define NO_INDEX ((size_t)-1)
+
+/* Private functions */
+
+static int nodeAdd(QxJsonProjection *self, QxJsonProjectionNode *node,
+	wchar_t const *pointer, size_t size, wchar_t *token);
+static QxJsonProjectionNode *nodeChild(QxJsonProjection *self,
+	QxJsonProjectionNode *parent, wchar_t const *token, size_t size);
+static int nodeCopy(QxJsonProjection *self, QxJsonProjectionNode *node,
+	QxJsonProjectionNode const *source);
+static void nodeDelete(QxJsonProjection *self, QxJsonProjectionNode *node);
+static size_t tokenIndex(wchar_t const *token, size_t size);
+
+/* Public implementations */
+
+QxJsonProjection *QxJsonProjection_new(void)
+{
+	QxJsonAllocator const *const allocator = QxJson_allocator();
+	QxJsonProjection *instance;
+
+	instance = (QxJsonProjection *)QxJsonAllocator_alloc(allocator,
+		sizeof(QxJsonProjection));
+
+	if (instance)
+	{
+		memset(instance, 0, sizeof(QxJsonProjection));
+		instance->allocator = allocator;
+		instance->root.index = NO_INDEX;
+	}
+
+	return instance;
+}
+
+void QxJsonProjection_release(QxJsonProjection *self)
+{
+	if (self)
+	{
+		nodeDelete(self, self->root.child);
+		QxJsonAllocator_free(self->allocator, self);
+	}
+}
+
+int QxJsonProjection_add(QxJsonProjection *self,
+	wchar_t const *pointer, size_t size)
+{
+	wchar_t *token;
+	int error;
+
+	if (!self || (!pointer && size) || (size && pointer[0] != L'/'))
+		/* Invalid argument */
+		return -1;
+
+	token = (wchar_t *)QxJsonAllocator_alloc(self->allocator,
+		(size + 1) * sizeof(wchar_t));
+
+	if (!token)
+		/* Out of memory */
+		return -1;
+
+	error = nodeAdd(self, &self->root, pointer, size, token);
+	QxJsonAllocator_free(self->allocator, token);
+	return error;
+}
+
+/* Private API */
+
+QxJsonProjectionNode const *QxJsonProjection_root(QxJsonProjection const *self)
+{
+	return self->root.all ? NULL : &self->root;
+}
+
+QxJsonProjectionNode const *QxJsonProjection_matchKey(
+	QxJsonProjectionNode const *self, wchar_t const *data, size_t size)
+{
+	QxJsonProjectionNode const *wildcard = NULL;
+	QxJsonProjectionNode const *node;
+
+	for (node = self->child; node; node = node->next)
+	{
+		if (node->wildcard)
+			wildcard = node;
+		else if (node->size == size
+			&& wmemcmp(node->token, data, size) == 0)
+			return node;
+	}
+
+	return wildcard;
+}
+
+QxJsonProjectionNode const *QxJsonProjection_matchIndex(
+	QxJsonProjectionNode const *self, size_t index)
+{
+	QxJsonProjectionNode const *wildcard = NULL;
+	QxJsonProjectionNode const *node;
+
+	for (node = self->child; node; node = node->next)
+	{
+		if (node->wildcard)
+			wildcard = node;
+		else if (node->index == index)
+			return node;
+	}
+
+	return wildcard;
+}
+
+int QxJsonProjection_matchAll(QxJsonProjectionNode const *self)
+{
+	return self->all;
+}
+
+int QxJsonProjection_matchLeaf(QxJsonProjectionNode const *self)
+{
+	return !self->child;
+}
+
+/* Private implementations */
+
+/* Select the rest of a pointer below a node. The token buffer holds the
+ * unescaped reference tokens, one at a time. */
+static int nodeAdd(QxJsonProjection *self, QxJsonProjectionNode *node,
+	wchar_t const *pointer, size_t size, wchar_t *token)
+{
+	QxJsonProjectionNode *child;
+	size_t length = 0;
+
+	if (!size)
+	{
+		node->all = 1;
+		return 0;
+	}
+
+	/* Skip the slash, then unescape the reference token */
+	++pointer;
+	--size;
+
+	for (; size && *pointer != L'/'; ++pointer, --size)
+	{
+		if (*pointer != L'~')
+			token[length] = *pointer;
+		else if (size > 1 && pointer[1] == L'0')
+			token[length] = L'~';
+		else if (size > 1 && pointer[1] == L'1')
+			token[length] = L'/';
+		else
+			/* Invalid escape sequence */
+			return -1;
+
+		if (*pointer == L'~')
+		{
+			++pointer;
+			--size;
+		}
+
+		++length;
+	}
+
+	child = nodeChild(self, node, token, length);
+
+	if (!child)
+		/* Out of memory */
+		return -1;
+
+	if (child->wildcard)
+	{
+		/* The named siblings are matched instead of the wildcard, so they
+		 * select its paths as well */
+		for (node = node->child; node; node = node->next)
+		{
+			if (!node->wildcard && nodeAdd(self, node, pointer, size, token) != 0)
+				return -1;
+		}
+	}
+
+	return nodeAdd(self, child, pointer, size, token);
+}
+
+/* Find or create a child node. A new named child starts with the paths of
+ * its wildcard sibling. */
+static QxJsonProjectionNode *nodeChild(QxJsonProjection *self,
+	QxJsonProjectionNode *parent, wchar_t const *token, size_t size)
+{
+	int const wildcard = size == 1 && token[0] == L'*';
+	QxJsonProjectionNode *sibling = NULL;
+	QxJsonProjectionNode *node;
+
+	for (node = parent->child; node; node = node->next)
+	{
+		if (wildcard ? node->wildcard
+			: !node->wildcard && node->size == size
+				&& wmemcmp(node->token, token, size) == 0)
+			return node;
+
+		if (node->wildcard)
+			sibling = node;
+	}
+
+	node = (QxJsonProjectionNode *)QxJsonAllocator_alloc(self->allocator,
+		sizeof(QxJsonProjectionNode));
+
+	if (!node)
+		/* Out of memory */
+		return NULL;
+
+	memset(node, 0, sizeof(QxJsonProjectionNode));
+	node->wildcard = wildcard;
+	node->index = wildcard ? NO_INDEX : tokenIndex(token, size);
+
+	if (!wildcard)
+	{
+		node->token = (wchar_t *)QxJsonAllocator_alloc(self->allocator,
+			(size + 1) * sizeof(wchar_t));
+
+		if (!node->token)
+		{
+			/* Out of memory */
+			QxJsonAllocator_free(self->allocator, node);
+			return NULL;
+		}
+
+		wmemcpy(node->token, token, size);
+		node->token[size] = L'\0';
+		node->size = size;
+	}
+
+	node->next = parent->child;
+	parent->child = node;
+
+	if (sibling && nodeCopy(self, node, sibling) != 0)
+		/* Out of memory */
+		return NULL;
+
+	return node;
+}
+
+/* Merge the paths selected below a node into another one */
+static int nodeCopy(QxJsonProjection *self, QxJsonProjectionNode *node,
+	QxJsonProjectionNode const *source)
+{
+	QxJsonProjectionNode *child;
+
+	node->all |= source->all;
+
+	for (source = source->child; source; source = source->next)
+	{
+		child = source->wildcard ? nodeChild(self, node, L"*", 1)
+			: nodeChild(self, node, source->token, source->size);
+
+		if (!child || nodeCopy(self, child, source) != 0)
+			/* Out of memory */
+			return -1;
+	}
+
+	return 0;
+}
+
+static void nodeDelete(QxJsonProjection *self, QxJsonProjectionNode *node)
+{
+	QxJsonProjectionNode *next;
+
+	for (; node; node = next)
+	{
+		next = node->next;
+		nodeDelete(self, node->child);
+
+		if (node->token)
+			QxJsonAllocator_free(self->allocator, node->token);
+
+		QxJsonAllocator_free(self->allocator, node);
+	}
+}
+
+/* The array index of a token ("0" or no leading zero), or NO_INDEX */
+static size_t tokenIndex(wchar_t const *token, size_t size)
+{
+	size_t index = 0;
+
+	if (!size || (size > 1 && token[0] == L'0'))
+		return NO_INDEX;
+
+	for (; size; ++token, --size)
+	{
+		if (*token < L'0' || *token > L'9' || index > (NO_INDEX - 10) / 10)
+			return NO_INDEX;
+
+		index = index * 10 + (size_t)(*token - L'0');
+	}
+
+	return index;
+}
@@ -0,0 +1,201 @@
+/**
+ * @file qx.json.private.h
+ * @brief Private declarations shared by the sources of the library.
+ * @author Romain DEOUX
+ */
+
+#ifndef _H_QX_JSON_PRIVATE
+#define _H_QX_JSON_PRIVATE
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../include/qx.json.allocator.h"
+#include "../include/qx.json.parser.h"
+#include "../include/qx.json.projection.h"
+#include "../include/qx.json.value.h"
+
+/* Memory */
+
+typedef union MaxAlign
+{
+	double number;
+	void *pointer;
+	long integer;
+} MaxAlign;
+
+/* The standard malloc/realloc/free allocator */
+extern QxJsonAllocator const QxJsonAllocator_system;
+
+#define QxJsonAllocator_alloc(self, size) \
+	((self)->allocate((self)->ptr, (size)))
+#define QxJsonAllocator_realloc(self, block, size) \
+	((self)->reallocate((self)->ptr, (block), (size)))
+#define QxJsonAllocator_free(self, block) \
+	((self)->deallocate((self)->ptr, (block)))
+
+/* Arena */
+
+/**
+ * @brief A bump pointer allocator holding a whole document.
+ *
+ * The root container of the document owns the arena (see
+ * QxJsonValue_ownArena()): releasing it frees every chunk at once. Other arena
+ * values ignore their reference counter and live as long as the root.
+ */
+typedef struct QxJsonArena QxJsonArena;
+
+QxJsonArena *QxJsonArena_new(QxJsonAllocator const *allocator);
+void QxJsonArena_delete(QxJsonArena *self);
+void *QxJsonArena_alloc(QxJsonArena *self, size_t size);
+void *QxJsonArena_realloc(QxJsonArena *self, void *ptr,
+	size_t oldSize, size_t size);
+
+/* Keep a reference to a heap value stored in an arena container.
+ * The reference is released when the arena is deleted. */
+int QxJsonArena_adopt(QxJsonArena *self, QxJsonValue *value);
+
+/* Make room for @c count adoptions, which then cannot fail */
+int QxJsonArena_reserve(QxJsonArena *self, size_t count);
+
+/* Where new values are allocated from */
+typedef struct QxJsonMemory
+{
+	QxJsonAllocator const *allocator;
+	QxJsonArena *arena; /* Takes precedence over the allocator if not NULL */
+} QxJsonMemory;
+
+/* Value constructors (a NULL memory stands for the default allocator) */
+
+QxJsonValue *QxJsonValue_arrayNewIn(QxJsonMemory const *memory);
+QxJsonValue *QxJsonValue_falseNewIn(QxJsonMemory const *memory);
+QxJsonValue *QxJsonValue_nullNewIn(QxJsonMemory const *memory);
+QxJsonValue *QxJsonValue_numberNewIn(QxJsonMemory const *memory, double value);
+QxJsonValue *QxJsonValue_numberNewInt64In(QxJsonMemory const *memory, int64_t value);
+QxJsonValue *QxJsonValue_numberNewUint64In(QxJsonMemory const *memory, uint64_t value);
+
+/* A number decoded on first use, from a validated text */
+QxJsonValue *QxJsonValue_numberNewTextIn(QxJsonMemory const *memory,
+	wchar_t const *text, size_t size);
+QxJsonValue *QxJsonValue_objectNewIn(QxJsonMemory const *memory);
+QxJsonValue *QxJsonValue_stringNewIn(QxJsonMemory const *memory,
+	wchar_t const *data, size_t size);
+QxJsonValue *QxJsonValue_stringNewUtf8In(QxJsonMemory const *memory,
+	char const *data, size_t size);
+
+/* A string stored as UTF-8, unless the wide characters hold lone surrogates */
+QxJsonValue *QxJsonValue_stringNewAsUtf8In(QxJsonMemory const *memory,
+	wchar_t const *data, size_t size);
+QxJsonValue *QxJsonValue_trueNewIn(QxJsonMemory const *memory);
+
+/* Make an arena container the owner of its arena */
+void QxJsonValue_ownArena(QxJsonValue *self);
+
+/* Keys */
+
+#define QX_JSON_KEY_CACHE_SLOTS 64
+#define QX_JSON_KEY_CACHE_MAX_SIZE 32
+
+/* The short keys lately created for a document, so that the objects sharing
+ * a key hold the same string value. To be cleared before the document goes
+ * away. */
+typedef struct QxJsonKeyCache
+{
+	QxJsonValue *keys[QX_JSON_KEY_CACHE_SLOTS];
+	size_t count;
+} QxJsonKeyCache;
+
+/* A new reference to a key string, shared if possible, and stored as UTF-8
+ * if @c utf8 is not 0 */
+QxJsonValue *QxJsonKeyCache_get(QxJsonKeyCache *self, QxJsonMemory const *memory,
+	wchar_t const *data, size_t size, int utf8);
+void QxJsonKeyCache_clear(QxJsonKeyCache *self);
+
+/* Numbers */
+
+/* A number decoded while being tokenized */
+typedef struct QxJsonNumber
+{
+	uint64_t mantissa;  /* The first 19 significant digits */
+	long exponent;      /* Decimal exponent of the mantissa */
+	long exponentValue; /* Explicit exponent, saturated */
+	int exponentNegative;
+	int digits;         /* Significant digits within the mantissa */
+	int truncated;      /* Non-zero digits did not fit the mantissa */
+	int decimal;        /* Has a fraction or an exponent */
+	int negative;
+} QxJsonNumber;
+
+/* Accumulate a digit into the mantissa, or into the exponent when the
+ * mantissa is full */
+void QxJsonNumber_digit(QxJsonNumber *self, wchar_t character, int fraction);
+void QxJsonNumber_exponentDigit(QxJsonNumber *self, wchar_t character);
+
+/* Decode the state of a validated number text at once */
+void QxJsonNumber_scan(QxJsonNumber *self, wchar_t const *text, size_t size);
+
+/* The nearest double. The validated text of the number is only used when
+ * the fast paths cannot decide, and may need memory from the allocator. */
+int QxJsonNumber_toDouble(QxJsonNumber const *self,
+	QxJsonAllocator const *allocator, wchar_t const *text, size_t size,
+	double *value);
+
+/* The magnitude of an integer number, if it fits 64 bits with its sign */
+int QxJsonNumber_toInteger(QxJsonNumber const *self,
+	wchar_t const *text, size_t size, uint64_t *magnitude);
+
+/* Scanning */
+
+/* Bit masks of the character classes of a 64 bytes block, bit i standing
+ * for the byte i */
+typedef struct QxJsonClasses
+{
+	uint64_t quote;
+	uint64_t backslash;
+	uint64_t space;
+	uint64_t structural; /* Brackets, braces, colons and commas */
+} QxJsonClasses;
+
+#define QX_JSON_BLOCK_SIZE 64
+
+/* Kernels returning the length of the leading run of white spaces, or of
+ * plain string characters (ASCII only for UTF-8), and classifying blocks */
+typedef struct QxJsonScanner
+{
+	size_t (*wideSpace)(wchar_t const *data, size_t size);
+	size_t (*wideString)(wchar_t const *data, size_t size);
+	size_t (*utf8String)(unsigned char const *data, size_t size);
+	void (*utf8Classify)(unsigned char const *block, QxJsonClasses *classes);
+} QxJsonScanner;
+
+/* The fastest kernels supported by the processor */
+QxJsonScanner const *QxJsonScanner_get(void);
+
+/* Parser */
+
+/* Default capacity of the token buffer kept between documents */
+#define QX_JSON_BUFFER_CAPACITY 512
+
+/* The allocator a parser was created with */
+QxJsonAllocator const *QxJsonParser_allocator(QxJsonParser const *self);
+
+/* Projection */
+
+typedef struct QxJsonProjectionNode QxJsonProjectionNode;
+
+/* The node of the document root, NULL if the whole document is selected */
+QxJsonProjectionNode const *QxJsonProjection_root(QxJsonProjection const *self);
+
+/* The child node selecting a member or an item, NULL if none */
+QxJsonProjectionNode const *QxJsonProjection_matchKey(
+	QxJsonProjectionNode const *self, wchar_t const *data, size_t size);
+QxJsonProjectionNode const *QxJsonProjection_matchIndex(
+	QxJsonProjectionNode const *self, size_t index);
+
+/* Whether the whole value of a node is selected */
+int QxJsonProjection_matchAll(QxJsonProjectionNode const *self);
+
+/* Whether no path continues below a node */
+int QxJsonProjection_matchLeaf(QxJsonProjectionNode const *self);
+
+#endif /* _H_QX_JSON_PRIVATE */
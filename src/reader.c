@@ -0,0 +1,575 @@
+/**
+ * @file reader.c
+ * @brief Source file of the QxJsonReader class.
+ * @author Romain DEOUX
+ */
+
+#include <assert.h>
+#include <string.h>
+
+#include "../include/qx.json.parser.h"
+#include "../include/qx.json.reader.h"
+#include "qx.json.private.h"
+
+/* Private structure */
+
+typedef struct ReaderEvent
+{
+	QxJsonEvent type;
+	wchar_t const *string; /* Set when the event is read */
+	size_t offset;         /* Of the text copied by the reader */
+	size_t size;
+	double number;
+	int integer;       /* Integer numbers */
+	int negative;
+	uint64_t magnitude;
+} ReaderEvent;
+
+/* Input fed to the parser at once */
+#define SLICE_SIZE 4096
+
+struct QxJsonReader
+{
+	QxJsonAllocator const *allocator;
+	QxJsonParser *parser;
+
+	/* Input, either wide or UTF-8 */
+	wchar_t const *wideData;
+	char const *utf8Data;
+	size_t size;
+	int ended;
+	int failed;
+
+	/* Events raised by the last slice but not read yet */
+	ReaderEvent *queueData;
+	size_t queueHead;
+	size_t queueSize;
+	size_t queueAlloc;
+
+	/* Text of the queued key and string events */
+	wchar_t *textData;
+	size_t textSize;
+	size_t textAlloc;
+
+	/* Skipping level */
+	size_t skipDepth; /* Open containers being skipped */
+	int skipValue;    /* The value of a key is being skipped */
+
+	ReaderEvent current;
+};
+
+/* Private functions */
+
+static QxJsonReader *readerNew(void);
+static int readerFill(QxJsonReader *self);
+static int readerSkips(QxJsonReader *self, QxJsonEvent type);
+static void readerDrain(QxJsonReader *self);
+static ReaderEvent *queueEvent(QxJsonReader *self, QxJsonEvent type);
+static int queueBare(QxJsonReader *self, QxJsonEvent type);
+static int queueText(QxJsonReader *self, QxJsonEvent type,
+	wchar_t const *data, size_t size);
+
+static int onBeginArray(void *ptr);
+static int onEndArray(void *ptr);
+static int onBeginObject(void *ptr);
+static int onEndObject(void *ptr);
+static int onKey(void *ptr, wchar_t const *data, size_t size);
+static int onString(void *ptr, wchar_t const *data, size_t size);
+static int onNumber(void *ptr, double value);
+static int onInteger(void *ptr, int64_t value);
+static int onUnsignedInteger(void *ptr, uint64_t value);
+static int onBoolean(void *ptr, int value);
+static int onNull(void *ptr);
+
+/* Private constants */
+
+static QxJsonHandler const readerHandler = {
+	&onBeginArray, &onEndArray,
+	&onBeginObject, &onEndObject,
+	&onKey, &onString, &onNumber, &onBoolean, &onNull,
+	&onInteger, &onUnsignedInteger
+};
+
+/* Public implementations */
+
+QxJsonReader *QxJsonReader_new(wchar_t const *data, size_t size)
+{
+	QxJsonReader *instance;
+
+	if (!data)
+		/* Invalid argument */
+		return NULL;
+
+	instance = readerNew();
+
+	if (instance)
+	{
+		instance->wideData = data;
+		instance->size = size;
+	}
+
+	return instance;
+}
+
+QxJsonReader *QxJsonReader_newUtf8(char const *data, size_t size)
+{
+	QxJsonReader *instance;
+
+	if (!data)
+		/* Invalid argument */
+		return NULL;
+
+	instance = readerNew();
+
+	if (instance)
+	{
+		instance->utf8Data = data;
+		instance->size = size;
+	}
+
+	return instance;
+}
+
+void QxJsonReader_release(QxJsonReader *self)
+{
+	if (self)
+	{
+		QxJsonParser_release(self->parser);
+
+		if (self->queueData)
+			QxJsonAllocator_free(self->allocator, self->queueData);
+
+		if (self->textData)
+			QxJsonAllocator_free(self->allocator, self->textData);
+
+		QxJsonAllocator_free(self->allocator, self);
+	}
+}
+
+QxJsonEvent QxJsonReader_next(QxJsonReader *self)
+{
+	if (!self)
+		/* Invalid argument */
+		return QxJsonEventError;
+
+	if (!self->queueSize && self->parser)
+	{
+		/* The previous slice has been read */
+		self->queueHead = 0;
+		self->textSize = 0;
+
+		if (readerFill(self) != 0)
+			self->failed = 1;
+
+		if (self->failed || !self->queueSize)
+		{
+			/* The parser is not needed anymore */
+			QxJsonParser_release(self->parser);
+			self->parser = NULL;
+		}
+	}
+
+	if (!self->queueSize)
+	{
+		/* The end or an error has been reached */
+		memset(&self->current, 0, sizeof(ReaderEvent));
+		self->current.type = self->failed ? QxJsonEventError : QxJsonEventEnd;
+		return self->current.type;
+	}
+
+	self->current = self->queueData[self->queueHead++];
+	--self->queueSize;
+
+	if (self->current.type == QxJsonEventKey || self->current.type == QxJsonEventString)
+		self->current.string = self->textData + self->current.offset;
+
+	return self->current.type;
+}
+
+wchar_t const *QxJsonReader_string(QxJsonReader const *self, size_t *size)
+{
+	if (!self || !self->current.string)
+		/* Invalid argument / no text */
+		return NULL;
+
+	if (size)
+		*size = self->current.size;
+
+	return self->current.string;
+}
+
+double QxJsonReader_number(QxJsonReader const *self)
+{
+	if (!self)
+		/* Invalid argument */
+		return 0;
+
+	return self->current.number;
+}
+
+int QxJsonReader_int64(QxJsonReader const *self, int64_t *value)
+{
+	if (!self || !value)
+		/* Invalid argument */
+		return -1;
+
+	if (!self->current.integer)
+		/* Not an integer */
+		return -1;
+
+	if (self->current.negative)
+		*value = -(int64_t)(self->current.magnitude - 1) - 1;
+	else if (self->current.magnitude <= INT64_MAX)
+		*value = (int64_t)self->current.magnitude;
+	else
+		/* Out of range */
+		return -1;
+
+	return 0;
+}
+
+int QxJsonReader_uint64(QxJsonReader const *self, uint64_t *value)
+{
+	if (!self || !value)
+		/* Invalid argument */
+		return -1;
+
+	if (!self->current.integer || self->current.negative)
+		/* Not an integer within range */
+		return -1;
+
+	*value = self->current.magnitude;
+	return 0;
+}
+
+int QxJsonReader_skip(QxJsonReader *self)
+{
+	if (!self)
+		/* Invalid argument */
+		return -1;
+
+	switch (self->current.type)
+	{
+	case QxJsonEventBeginArray:
+	case QxJsonEventBeginObject:
+		self->skipDepth = 1;
+		readerDrain(self);
+
+		switch (QxJsonReader_next(self))
+		{
+		case QxJsonEventEndArray:
+		case QxJsonEventEndObject:
+			return 0;
+
+		default:
+			/* Truncated document */
+			return -1;
+		}
+
+	case QxJsonEventKey:
+		/* The value is skipped while reading the next event */
+		self->skipValue = 1;
+		readerDrain(self);
+		return 0;
+
+	default:
+		/* Nothing to skip */
+		return 0;
+	}
+}
+
+/* Private implementations */
+
+static QxJsonReader *readerNew(void)
+{
+	QxJsonAllocator const *const allocator = QxJson_allocator();
+	QxJsonReader *instance;
+
+	instance = (QxJsonReader *)QxJsonAllocator_alloc(allocator, sizeof(QxJsonReader));
+
+	if (instance)
+	{
+		memset(instance, 0, sizeof(QxJsonReader));
+		instance->allocator = allocator;
+		instance->parser = QxJsonParser_newWithAllocator(allocator);
+
+		if (!instance->parser
+			|| QxJsonParser_setHandler(instance->parser, &readerHandler, instance) != 0)
+		{
+			QxJsonReader_release(instance);
+			return NULL;
+		}
+	}
+
+	return instance;
+}
+
+/* Feed the parser by slices until it raises an event or the input is
+ * exhausted. The text of the events raised by a slice is copied, so that it
+ * stays valid while the following events are read. */
+static int readerFill(QxJsonReader *self)
+{
+	size_t count;
+	int error = 0;
+
+	while (!self->queueSize && self->size && !error)
+	{
+		count = self->size < SLICE_SIZE ? self->size : SLICE_SIZE;
+
+		if (self->wideData)
+		{
+			error = QxJsonParser_feed(self->parser, self->wideData, count);
+			self->wideData += count;
+		}
+		else
+		{
+			error = QxJsonParser_feedUtf8(self->parser, self->utf8Data, count);
+			self->utf8Data += count;
+		}
+
+		self->size -= count;
+	}
+
+	if (!self->queueSize && !self->size && !self->ended && !error)
+	{
+		/* May raise a pending root number */
+		self->ended = 1;
+		error = QxJsonParser_end(self->parser, NULL);
+	}
+
+	return error;
+}
+
+/* Tell whether an event belongs to the value being skipped. The end of a
+ * container skipped from its beginning is kept: it becomes the current
+ * event. */
+static int readerSkips(QxJsonReader *self, QxJsonEvent type)
+{
+	if (!self->skipDepth)
+	{
+		if (!self->skipValue)
+			/* Not skipping */
+			return 0;
+
+		if (type == QxJsonEventBeginArray || type == QxJsonEventBeginObject)
+			self->skipDepth = 1;
+		else
+			/* A scalar value */
+			self->skipValue = 0;
+
+		return 1;
+	}
+
+	switch (type)
+	{
+	case QxJsonEventBeginArray:
+	case QxJsonEventBeginObject:
+		++self->skipDepth;
+		return 1;
+
+	case QxJsonEventEndArray:
+	case QxJsonEventEndObject:
+		if (--self->skipDepth)
+			return 1;
+
+		if (!self->skipValue)
+			return 0;
+
+		self->skipValue = 0;
+		return 1;
+
+	default:
+		return 1;
+	}
+}
+
+/* Drop the queued events of the value being skipped. The rest of the value
+ * is dropped as the parser raises it. */
+static void readerDrain(QxJsonReader *self)
+{
+	while (self->queueSize && readerSkips(self, self->queueData[self->queueHead].type))
+	{
+		++self->queueHead;
+		--self->queueSize;
+	}
+}
+
+static ReaderEvent *queueEvent(QxJsonReader *self, QxJsonEvent type)
+{
+	ReaderEvent *event;
+	size_t alloc;
+
+	if (self->queueHead + self->queueSize == self->queueAlloc)
+	{
+		alloc = self->queueAlloc ? self->queueAlloc * 2 : 16;
+		event = (ReaderEvent *)QxJsonAllocator_realloc(self->allocator,
+			self->queueData, alloc * sizeof(ReaderEvent));
+
+		if (!event)
+			/* Memory allocation failure */
+			return NULL;
+
+		self->queueData = event;
+		self->queueAlloc = alloc;
+	}
+
+	event = &self->queueData[self->queueHead + self->queueSize];
+	memset(event, 0, sizeof(ReaderEvent));
+	event->type = type;
+	++self->queueSize;
+	return event;
+}
+
+static int queueText(QxJsonReader *self, QxJsonEvent type,
+	wchar_t const *data, size_t size)
+{
+	ReaderEvent *event;
+	wchar_t *text;
+	size_t alloc;
+
+	if (readerSkips(self, type))
+		return 0;
+
+	if (self->textSize + size + 1 > self->textAlloc)
+	{
+		alloc = self->textAlloc ? self->textAlloc : 256;
+
+		while (alloc < self->textSize + size + 1)
+			alloc *= 2;
+
+		text = (wchar_t *)QxJsonAllocator_realloc(self->allocator,
+			self->textData, alloc * sizeof(wchar_t));
+
+		if (!text)
+			/* Memory allocation failure */
+			return -1;
+
+		self->textData = text;
+		self->textAlloc = alloc;
+	}
+
+	event = queueEvent(self, type);
+
+	if (!event)
+		/* Memory allocation failure */
+		return -1;
+
+	event->offset = self->textSize;
+	event->size = size;
+	memcpy(self->textData + self->textSize, data, size * sizeof(wchar_t));
+	self->textData[self->textSize + size] = L'\0';
+	self->textSize += size + 1;
+	return 0;
+}
+
+/* An event without payload. A container starting within a skipped value is
+ * scanned by the parser up to its end, without raising events. */
+static int queueBare(QxJsonReader *self, QxJsonEvent type)
+{
+	if (!readerSkips(self, type))
+		return queueEvent(self, type) ? 0 : -1;
+
+	if (type == QxJsonEventBeginArray || type == QxJsonEventBeginObject)
+		return QxJsonParser_skip(self->parser);
+
+	return 0;
+}
+
+static int onBeginArray(void *ptr)
+{
+	return queueBare((QxJsonReader *)ptr, QxJsonEventBeginArray);
+}
+
+static int onEndArray(void *ptr)
+{
+	return queueBare((QxJsonReader *)ptr, QxJsonEventEndArray);
+}
+
+static int onBeginObject(void *ptr)
+{
+	return queueBare((QxJsonReader *)ptr, QxJsonEventBeginObject);
+}
+
+static int onEndObject(void *ptr)
+{
+	return queueBare((QxJsonReader *)ptr, QxJsonEventEndObject);
+}
+
+static int onKey(void *ptr, wchar_t const *data, size_t size)
+{
+	return queueText((QxJsonReader *)ptr, QxJsonEventKey, data, size);
+}
+
+static int onString(void *ptr, wchar_t const *data, size_t size)
+{
+	return queueText((QxJsonReader *)ptr, QxJsonEventString, data, size);
+}
+
+static int onNumber(void *ptr, double value)
+{
+	QxJsonReader *const self = (QxJsonReader *)ptr;
+	ReaderEvent *event;
+
+	if (readerSkips(self, QxJsonEventNumber))
+		return 0;
+
+	event = queueEvent(self, QxJsonEventNumber);
+
+	if (!event)
+		/* Memory allocation failure */
+		return -1;
+
+	event->number = value;
+	return 0;
+}
+
+static int onInteger(void *ptr, int64_t value)
+{
+	QxJsonReader *const self = (QxJsonReader *)ptr;
+	ReaderEvent *event;
+
+	if (readerSkips(self, QxJsonEventNumber))
+		return 0;
+
+	event = queueEvent(self, QxJsonEventNumber);
+
+	if (!event)
+		/* Memory allocation failure */
+		return -1;
+
+	event->number = (double)value;
+	event->integer = 1;
+	event->negative = value < 0;
+	event->magnitude = value < 0 ? (uint64_t)-(value + 1) + 1 : (uint64_t)value;
+	return 0;
+}
+
+static int onUnsignedInteger(void *ptr, uint64_t value)
+{
+	QxJsonReader *const self = (QxJsonReader *)ptr;
+	ReaderEvent *event;
+
+	if (readerSkips(self, QxJsonEventNumber))
+		return 0;
+
+	event = queueEvent(self, QxJsonEventNumber);
+
+	if (!event)
+		/* Memory allocation failure */
+		return -1;
+
+	event->number = (double)value;
+	event->integer = 1;
+	event->magnitude = value;
+	return 0;
+}
+
+static int onBoolean(void *ptr, int value)
+{
+	return queueBare((QxJsonReader *)ptr, value ? QxJsonEventTrue : QxJsonEventFalse);
+}
+
+static int onNull(void *ptr)
+{
+	return queueBare((QxJsonReader *)ptr, QxJsonEventNull);
+}
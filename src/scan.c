@@ -0,0 +1,415 @@
+/**
+ * @file scan.c
+ * @brief Source file of the block scanning kernels.
+ * @author Romain DEOUX
+ */
+
+#include <pthread.h>
+#include <string.h>
+#include <wchar.h>
+
+#include "qx.json.private.h"
+
+/* The vector kernels need GCC or Clang on x86-64, where SSE2 is always
+ * available and AVX2 is detected at runtime */
+#if defined(__GNUC__) && defined(__x86_64__)
+#  define SCAN_X86 1
+#  include <immintrin.h>
+#else
+#  define SCAN_X86 0
+#endif
+
+/* Wide kernels compare 32 bits lanes */
+#if SCAN_X86 && WCHAR_MAX > 0xFFFF
+#  define SCAN_X86_WIDE 1
+#else
+#  define SCAN_X86_WIDE 0
+#endif
+
+#define isSpace(character) ((character) == L' ' || (character) == L'\t' \
+	|| (character) == L'\n' || (character) == L'\r')
+
+/* Quote, backslash, control character, or any negative wchar_t */
+#define isSpecial(character) \
+	((character) == L'"' || (character) == L'\\' || (character) < 0x20)
+
+/* Private functions */
+
+static size_t scalarWideSpace(wchar_t const *data, size_t size);
+static size_t scalarWideString(wchar_t const *data, size_t size);
+static size_t scalarUtf8String(unsigned char const *data, size_t size);
+static void scalarUtf8Classify(unsigned char const *block, QxJsonClasses *classes);
+
+#if SCAN_X86
+static size_t sse2Utf8String(unsigned char const *data, size_t size);
+static size_t avx2Utf8String(unsigned char const *data, size_t size);
+static void sse2Utf8Classify(unsigned char const *block, QxJsonClasses *classes);
+static void avx2Utf8Classify(unsigned char const *block, QxJsonClasses *classes);
+#endif
+
+#if SCAN_X86_WIDE
+static size_t sse2WideSpace(wchar_t const *data, size_t size);
+static size_t sse2WideString(wchar_t const *data, size_t size);
+static size_t avx2WideSpace(wchar_t const *data, size_t size);
+static size_t avx2WideString(wchar_t const *data, size_t size);
+#endif
+
+static void scannerInit(void);
+
+/* Private constants */
+
+static QxJsonScanner const scalarScanner = {
+	&scalarWideSpace, &scalarWideString,
+	&scalarUtf8String,
+	&scalarUtf8Classify
+};
+
+#if SCAN_X86
+static QxJsonScanner const sse2Scanner = {
+#  if SCAN_X86_WIDE
+	&sse2WideSpace, &sse2WideString,
+#  else
+	&scalarWideSpace, &scalarWideString,
+#  endif
+	&sse2Utf8String,
+	&sse2Utf8Classify
+};
+
+static QxJsonScanner const avx2Scanner = {
+#  if SCAN_X86_WIDE
+	&avx2WideSpace, &avx2WideString,
+#  else
+	&scalarWideSpace, &scalarWideString,
+#  endif
+	&avx2Utf8String,
+	&avx2Utf8Classify
+};
+#endif
+
+/* Private variables */
+
+static pthread_once_t scannerOnce = PTHREAD_ONCE_INIT;
+static QxJsonScanner const *scanner = &scalarScanner;
+
+/* Public implementations */
+
+QxJsonScanner const *QxJsonScanner_get(void)
+{
+	pthread_once(&scannerOnce, &scannerInit);
+	return scanner;
+}
+
+/* Private implementations */
+
+static void scannerInit(void)
+{
+#if SCAN_X86
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("avx2"))
+		scanner = &avx2Scanner;
+	else
+		scanner = &sse2Scanner;
+#endif
+}
+
+static size_t scalarWideSpace(wchar_t const *data, size_t size)
+{
+	size_t index = 0;
+
+	while (index != size && isSpace(data[index]))
+		++index;
+
+	return index;
+}
+
+static size_t scalarWideString(wchar_t const *data, size_t size)
+{
+	size_t index = 0;
+
+	while (index != size && !isSpecial(data[index]))
+		++index;
+
+	return index;
+}
+
+static size_t scalarUtf8String(unsigned char const *data, size_t size)
+{
+	size_t index = 0;
+
+	while (index != size && data[index] < 0x80 && !isSpecial(data[index]))
+		++index;
+
+	return index;
+}
+
+static void scalarUtf8Classify(unsigned char const *block, QxJsonClasses *classes)
+{
+	uint64_t bit = 1;
+	size_t index;
+
+	memset(classes, 0, sizeof(QxJsonClasses));
+
+	for (index = 0; index != QX_JSON_BLOCK_SIZE; ++index, bit <<= 1)
+	{
+		switch (block[index])
+		{
+		case '"':
+			classes->quote |= bit;
+			break;
+
+		case '\\':
+			classes->backslash |= bit;
+			break;
+
+		case ' ':
+		case '\t':
+		case '\n':
+		case '\r':
+			classes->space |= bit;
+			break;
+
+		case '[':
+		case ']':
+		case '{':
+		case '}':
+		case ':':
+		case ',':
+			classes->structural |= bit;
+			break;
+
+		default:
+			break;
+		}
+	}
+}
+
+#if SCAN_X86
+
+/* Each kernel builds a mask of the lanes ending the run, then returns the
+ * offset of its lowest bit. The tail is left to the narrower kernels. */
+
+static size_t sse2Utf8String(unsigned char const *data, size_t size)
+{
+	__m128i const quote = _mm_set1_epi8('"');
+	__m128i const backslash = _mm_set1_epi8('\\');
+	__m128i const control = _mm_set1_epi8(0x1F);
+	__m128i block, plain;
+	unsigned int mask;
+	size_t index = 0;
+
+	for (; size - index >= 16; index += 16)
+	{
+		block = _mm_loadu_si128((__m128i const *)(data + index));
+
+		/* Signed comparison: non-ASCII bytes are negative */
+		plain = _mm_andnot_si128(
+			_mm_or_si128(_mm_cmpeq_epi8(block, quote), _mm_cmpeq_epi8(block, backslash)),
+			_mm_cmpgt_epi8(block, control));
+		mask = ~(unsigned int)_mm_movemask_epi8(plain) & 0xFFFF;
+
+		if (mask)
+			return index + (size_t)__builtin_ctz(mask);
+	}
+
+	return index + scalarUtf8String(data + index, size - index);
+}
+
+/* Masks of 16 bytes */
+#define sse2Equal(block, character) \
+	_mm_cmpeq_epi8((block), _mm_set1_epi8(character))
+#define sse2Mask(match) ((uint64_t)(unsigned int)_mm_movemask_epi8(match))
+
+static void sse2Utf8Classify(unsigned char const *block, QxJsonClasses *classes)
+{
+	__m128i data, space, structural;
+	unsigned int offset;
+
+	memset(classes, 0, sizeof(QxJsonClasses));
+
+	for (offset = 0; offset != QX_JSON_BLOCK_SIZE; offset += 16)
+	{
+		data = _mm_loadu_si128((__m128i const *)(block + offset));
+		space = _mm_or_si128(
+			_mm_or_si128(sse2Equal(data, ' '), sse2Equal(data, '\t')),
+			_mm_or_si128(sse2Equal(data, '\n'), sse2Equal(data, '\r')));
+		structural = _mm_or_si128(
+			_mm_or_si128(
+				_mm_or_si128(sse2Equal(data, '['), sse2Equal(data, ']')),
+				_mm_or_si128(sse2Equal(data, '{'), sse2Equal(data, '}'))),
+			_mm_or_si128(sse2Equal(data, ':'), sse2Equal(data, ',')));
+
+		classes->quote |= sse2Mask(sse2Equal(data, '"')) << offset;
+		classes->backslash |= sse2Mask(sse2Equal(data, '\\')) << offset;
+		classes->space |= sse2Mask(space) << offset;
+		classes->structural |= sse2Mask(structural) << offset;
+	}
+}
+
+__attribute__((target("avx2")))
+static size_t avx2Utf8String(unsigned char const *data, size_t size)
+{
+	__m256i const quote = _mm256_set1_epi8('"');
+	__m256i const backslash = _mm256_set1_epi8('\\');
+	__m256i const control = _mm256_set1_epi8(0x1F);
+	__m256i block, plain;
+	unsigned int mask;
+	size_t index = 0;
+
+	for (; size - index >= 32; index += 32)
+	{
+		block = _mm256_loadu_si256((__m256i const *)(data + index));
+		plain = _mm256_andnot_si256(
+			_mm256_or_si256(_mm256_cmpeq_epi8(block, quote),
+				_mm256_cmpeq_epi8(block, backslash)),
+			_mm256_cmpgt_epi8(block, control));
+		mask = ~(unsigned int)_mm256_movemask_epi8(plain);
+
+		if (mask)
+			return index + (size_t)__builtin_ctz(mask);
+	}
+
+	return index + sse2Utf8String(data + index, size - index);
+}
+
+/* Masks of 32 bytes */
+#define avx2Equal(block, character) \
+	_mm256_cmpeq_epi8((block), _mm256_set1_epi8(character))
+#define avx2Mask(match) ((uint64_t)(unsigned int)_mm256_movemask_epi8(match))
+
+__attribute__((target("avx2")))
+static void avx2Utf8Classify(unsigned char const *block, QxJsonClasses *classes)
+{
+	__m256i data, space, structural;
+	unsigned int offset;
+
+	memset(classes, 0, sizeof(QxJsonClasses));
+
+	for (offset = 0; offset != QX_JSON_BLOCK_SIZE; offset += 32)
+	{
+		data = _mm256_loadu_si256((__m256i const *)(block + offset));
+		space = _mm256_or_si256(
+			_mm256_or_si256(avx2Equal(data, ' '), avx2Equal(data, '\t')),
+			_mm256_or_si256(avx2Equal(data, '\n'), avx2Equal(data, '\r')));
+		structural = _mm256_or_si256(
+			_mm256_or_si256(
+				_mm256_or_si256(avx2Equal(data, '['), avx2Equal(data, ']')),
+				_mm256_or_si256(avx2Equal(data, '{'), avx2Equal(data, '}'))),
+			_mm256_or_si256(avx2Equal(data, ':'), avx2Equal(data, ',')));
+
+		classes->quote |= avx2Mask(avx2Equal(data, '"')) << offset;
+		classes->backslash |= avx2Mask(avx2Equal(data, '\\')) << offset;
+		classes->space |= avx2Mask(space) << offset;
+		classes->structural |= avx2Mask(structural) << offset;
+	}
+}
+
+#endif /* SCAN_X86 */
+
+#if SCAN_X86_WIDE
+
+static size_t sse2WideSpace(wchar_t const *data, size_t size)
+{
+	__m128i const space = _mm_set1_epi32(' ');
+	__m128i const tab = _mm_set1_epi32('\t');
+	__m128i const lineFeed = _mm_set1_epi32('\n');
+	__m128i const carriageReturn = _mm_set1_epi32('\r');
+	__m128i block, match;
+	unsigned int mask;
+	size_t index = 0;
+
+	for (; size - index >= 4; index += 4)
+	{
+		block = _mm_loadu_si128((__m128i const *)(data + index));
+		match = _mm_or_si128(
+			_mm_or_si128(_mm_cmpeq_epi32(block, space), _mm_cmpeq_epi32(block, tab)),
+			_mm_or_si128(_mm_cmpeq_epi32(block, lineFeed),
+				_mm_cmpeq_epi32(block, carriageReturn)));
+		mask = ~(unsigned int)_mm_movemask_ps(_mm_castsi128_ps(match)) & 0xF;
+
+		if (mask)
+			return index + (size_t)__builtin_ctz(mask);
+	}
+
+	return index + scalarWideSpace(data + index, size - index);
+}
+
+static size_t sse2WideString(wchar_t const *data, size_t size)
+{
+	__m128i const quote = _mm_set1_epi32('"');
+	__m128i const backslash = _mm_set1_epi32('\\');
+	__m128i const control = _mm_set1_epi32(0x20);
+	__m128i block, special;
+	unsigned int mask;
+	size_t index = 0;
+
+	for (; size - index >= 4; index += 4)
+	{
+		block = _mm_loadu_si128((__m128i const *)(data + index));
+		special = _mm_or_si128(
+			_mm_or_si128(_mm_cmpeq_epi32(block, quote), _mm_cmpeq_epi32(block, backslash)),
+			_mm_cmplt_epi32(block, control));
+		mask = (unsigned int)_mm_movemask_ps(_mm_castsi128_ps(special));
+
+		if (mask)
+			return index + (size_t)__builtin_ctz(mask);
+	}
+
+	return index + scalarWideString(data + index, size - index);
+}
+
+__attribute__((target("avx2")))
+static size_t avx2WideSpace(wchar_t const *data, size_t size)
+{
+	__m256i const space = _mm256_set1_epi32(' ');
+	__m256i const tab = _mm256_set1_epi32('\t');
+	__m256i const lineFeed = _mm256_set1_epi32('\n');
+	__m256i const carriageReturn = _mm256_set1_epi32('\r');
+	__m256i block, match;
+	unsigned int mask;
+	size_t index = 0;
+
+	for (; size - index >= 8; index += 8)
+	{
+		block = _mm256_loadu_si256((__m256i const *)(data + index));
+		match = _mm256_or_si256(
+			_mm256_or_si256(_mm256_cmpeq_epi32(block, space),
+				_mm256_cmpeq_epi32(block, tab)),
+			_mm256_or_si256(_mm256_cmpeq_epi32(block, lineFeed),
+				_mm256_cmpeq_epi32(block, carriageReturn)));
+		mask = ~(unsigned int)_mm256_movemask_ps(_mm256_castsi256_ps(match)) & 0xFF;
+
+		if (mask)
+			return index + (size_t)__builtin_ctz(mask);
+	}
+
+	return index + sse2WideSpace(data + index, size - index);
+}
+
+__attribute__((target("avx2")))
+static size_t avx2WideString(wchar_t const *data, size_t size)
+{
+	__m256i const quote = _mm256_set1_epi32('"');
+	__m256i const backslash = _mm256_set1_epi32('\\');
+	__m256i const control = _mm256_set1_epi32(0x20);
+	__m256i block, special;
+	unsigned int mask;
+	size_t index = 0;
+
+	for (; size - index >= 8; index += 8)
+	{
+		block = _mm256_loadu_si256((__m256i const *)(data + index));
+		special = _mm256_or_si256(
+			_mm256_or_si256(_mm256_cmpeq_epi32(block, quote),
+				_mm256_cmpeq_epi32(block, backslash)),
+			_mm256_cmpgt_epi32(control, block));
+		mask = (unsigned int)_mm256_movemask_ps(_mm256_castsi256_ps(special));
+
+		if (mask)
+			return index + (size_t)__builtin_ctz(mask);
+	}
+
+	return index + sse2WideString(data + index, size - index);
+}
+
+#endif /* SCAN_X86_WIDE */
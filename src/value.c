@@ -5,120 +5,316 @@
  */
 
 #include <assert.h>
+#include <fcntl.h>
 #include <math.h>
+#include <pthread.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <wchar.h>
 
 #include "../include/qx.json.value.h"
+#include "qx.json.private.h"
 
-typedef struct ArrayNode ArrayNode;
-struct ArrayNode
+typedef struct Array
 {
-	ArrayNode *next;
-	ArrayNode *previous;
-	QxJsonValue *value;
-};
+	QxJsonValue **items;
+	size_t alloc;
+	QxJsonArena *arena;
+} Array;
 
-#define ArrayNode_alloc() ((ArrayNode *)malloc(sizeof(ArrayNode)));
-#define ArrayNode_delete(node) do {   \
-	QxJsonValue_decref((node)->value); \
-	free((node));                      \
-} while (0)
+#define ARRAY_MIN_ALLOC 4
 
-typedef struct ObjectNode ObjectNode;
-struct ObjectNode
+typedef struct ObjectEntry
 {
-	ObjectNode *next;
-	ObjectNode *previous;
-	QxJsonValue *key;
+	QxJsonValue *key; /* NULL once the entry has been removed */
 	QxJsonValue *value;
-};
-
-#define ObjectNode_alloc() ((ObjectNode *)malloc(sizeof(ObjectNode)));
-#define ObjectNode_delete(node) do {  \
-	QxJsonValue_release((node)->key);   \
-	QxJsonValue_release((node)->value); \
-	free((node));                       \
-} while (0)
+	size_t hash;
+} ObjectEntry;
 
+typedef struct Object
+{
+	ObjectEntry *entries; /* In insertion order */
+	size_t count;         /* Used entries, including the removed ones */
+	size_t alloc;
+	size_t *slots;        /* Hash index: entry offset + 1 */
+	size_t mask;          /* Number of slots minus one, 0 without index */
+	QxJsonArena *arena;
+} Object;
+
+#define OBJECT_MIN_ALLOC 4
+#define OBJECT_INDEX_THRESHOLD 8
+#define SLOT_EMPTY   ((size_t)0)
+#define SLOT_REMOVED ((size_t)-1)
+
+/* A 16 bytes header. The variable part of the value follows it within the
+ * same block: the Array or Object of a container, the characters of a string
+ * or the size and text of a lazy number.
+ *
+ * The size of an UTF-8 string is its number of bytes. Its text follows the
+ * wide characters decoded on demand, and the arena of an arena string. */
 struct QxJsonValue
 {
-	QxJsonValueType type;
-	unsigned long int ref;
-	size_t size;
+	unsigned char type;
+	unsigned short flags;
+	uint32_t ref;
 	union
 	{
-		ArrayNode array;
-		double number;
-		ObjectNode object;
-		wchar_t *string;
+		double real;
+		int64_t integer;
+		uint64_t unsignedInteger;
+		size_t size; /* Of the containers and strings */
 	} data;
 };
 
-#define QxJsonValue_alloc() ((QxJsonValue *)malloc(sizeof(QxJsonValue)))
-#define QxJsonValue_init(self, t) do { \
-	(self)->type = (t); (self)->ref = 0; (self)->size = 0; \
-} while (0)
+#define valueArray(self)  ((Array *)((self) + 1))
+#define valueObject(self) ((Object *)((self) + 1))
+#define valueString(self) ((wchar_t *)((self) + 1))
+#define numberTextSize(self) (*(size_t *)((self) + 1))
+#define numberText(self) ((wchar_t *)((size_t *)((self) + 1) + 1))
+#define utf8Wide(self) (((wchar_t **)((self) + 1))[0])
+#define utf8Arena(self) (((QxJsonArena **)((self) + 1))[1])
+#define utf8Pointers(self) \
+	(sizeof(wchar_t *) * ((self)->flags & VALUE_ARENA ? 2 : 1))
+#define utf8Units(self) \
+	(*(size_t *)((char *)((self) + 1) + utf8Pointers(self)))
+#define utf8Text(self) ((char *)((self) + 1) + utf8Pointers(self) \
+	+ ((self)->flags & VALUE_ASCII ? 0 : sizeof(size_t)))
+
+#define VALUE_ARENA      0x1 /* Allocated from an arena */
+#define VALUE_ARENA_ROOT 0x2 /* Owns its arena */
+#define VALUE_ALLOCATOR  0x4 /* Preceded by its custom allocator */
+#define VALUE_INT64      0x8 /* A number holding data.integer */
+#define VALUE_UINT64    0x10 /* A number holding data.unsignedInteger */
+#define VALUE_LAZY      0x20 /* A number whose text is not decoded yet */
+#define VALUE_TEXT      0x40 /* A number followed by its source text */
+#define VALUE_IMMORTAL  0x80 /* A static instance, never counted nor freed */
+#define VALUE_UTF8     0x100 /* A string stored as UTF-8 */
+#define VALUE_ASCII    0x200 /* An UTF-8 string of ASCII characters only */
+
+/* 2^53: from there on, an integral double may be the rounding of another
+ * integer */
+#define EXACT_DOUBLE 9007199254740992.0
+
+/* The null, true and false values are shared by every document and thread */
+static QxJsonValue valueFalse = { QxJsonValueTypeFalse, VALUE_IMMORTAL, 0, { 0 } };
+static QxJsonValue valueNull = { QxJsonValueTypeNull, VALUE_IMMORTAL, 0, { 0 } };
+static QxJsonValue valueTrue = { QxJsonValueTypeTrue, VALUE_IMMORTAL, 0, { 0 } };
+
+/* Stored in front of the values using a custom allocator */
+typedef union ValuePrefix
+{
+	QxJsonAllocator const *allocator;
+	MaxAlign align;
+} ValuePrefix;
+
+#define valuePrefix(self) ((ValuePrefix *)(self) - 1)
+
+/* Small integers are held by the handle itself, as odd addresses cannot be
+ * values: the integer n is encoded as 2n + 1 */
+#define IMMEDIATE_MIN (INTPTR_MIN / 2)
+#define IMMEDIATE_MAX (INTPTR_MAX / 2)
+
+#define isImmediate(self) (((uintptr_t)(self) & 1) != 0)
+#define immediateNew(value) ((QxJsonValue *)((uintptr_t)(value) * 2 + 1))
+#define immediateValue(self) ((intptr_t)((uintptr_t)(self) - 1) / 2)
+
+#define valueType(self) (isImmediate(self) \
+	? QxJsonValueTypeNumber : (QxJsonValueType)(self)->type)
+
+#define containerArena(self) ((self)->type == QxJsonValueTypeArray \
+	? valueArray(self)->arena : valueObject(self)->arena)
+
+/* Allocate a value followed by @c extra bytes */
+static QxJsonValue *valueNew(QxJsonMemory const *memory, QxJsonValueType type,
+	size_t extra)
+{
+	QxJsonAllocator const *allocator;
+	QxJsonValue *instance = NULL;
+	ValuePrefix *prefix;
+	unsigned int flags = 0;
+
+	allocator = memory ? memory->allocator : QxJson_allocator();
+
+	if (memory && memory->arena)
+	{
+		instance = (QxJsonValue *)QxJsonArena_alloc(memory->arena,
+			sizeof(QxJsonValue) + extra);
+		flags = VALUE_ARENA;
+	}
+	else if (allocator == &QxJsonAllocator_system)
+	{
+		instance = (QxJsonValue *)malloc(sizeof(QxJsonValue) + extra);
+	}
+	else
+	{
+		prefix = (ValuePrefix *)QxJsonAllocator_alloc(allocator,
+			sizeof(ValuePrefix) + sizeof(QxJsonValue) + extra);
+
+		if (prefix)
+		{
+			prefix->allocator = allocator;
+			instance = (QxJsonValue *)(prefix + 1);
+			flags = VALUE_ALLOCATOR;
+		}
+	}
+
+	if (instance)
+	{
+		instance->type = (unsigned char)type;
+		instance->flags = (unsigned short)flags;
+		instance->ref = 0;
+		instance->data.size = 0;
+	}
+
+	return instance;
+}
+
+/* The allocator a value comes from, or the default one for arena values */
+static QxJsonAllocator const *valueAllocator(QxJsonValue const *self)
+{
+	if (self->flags & VALUE_ALLOCATOR)
+		return valuePrefix(self)->allocator;
+
+	if (self->flags & VALUE_ARENA)
+		return QxJson_allocator();
+
+	return &QxJsonAllocator_system;
+}
+
+static void valueDelete(QxJsonValue *self)
+{
+	if (self->flags & VALUE_ALLOCATOR)
+		QxJsonAllocator_free(valuePrefix(self)->allocator, valuePrefix(self));
+	else if (!(self->flags & VALUE_ARENA))
+		free(self);
+}
+
+/* (Re)allocate a buffer owned by a value */
+static void *bufferRealloc(QxJsonArena *arena, QxJsonValue const *owner,
+	void *ptr, size_t oldSize, size_t size)
+{
+	if (arena)
+		return QxJsonArena_realloc(arena, ptr, oldSize, size);
+
+	if (owner->flags & VALUE_ALLOCATOR)
+		return QxJsonAllocator_realloc(valuePrefix(owner)->allocator, ptr, size);
+
+	return realloc(ptr, size);
+}
+
+static void bufferFree(QxJsonArena *arena, QxJsonValue const *owner, void *ptr)
+{
+	if (arena || !ptr)
+		/* Freed along with the arena */
+		return;
+
+	if (owner->flags & VALUE_ALLOCATOR)
+		QxJsonAllocator_free(valuePrefix(owner)->allocator, ptr);
+	else
+		free(ptr);
+}
+
+/* Take over a reference to a value stored into a container */
+static int containerAdopt(QxJsonArena *arena, QxJsonValue *value)
+{
+	if (!arena || isImmediate(value)
+		|| (value->flags & (VALUE_ARENA | VALUE_IMMORTAL)))
+		/* Owned by the container / by the arena itself / by nobody */
+		return 0;
+
+	return QxJsonArena_adopt(arena, value);
+}
+
+void QxJsonValue_ownArena(QxJsonValue *self)
+{
+	assert(self->flags & VALUE_ARENA);
+	assert(self->type == QxJsonValueTypeArray
+		|| self->type == QxJsonValueTypeObject);
+	self->flags |= VALUE_ARENA_ROOT;
+}
 
 void QxJsonValue_retains(QxJsonValue *self)
 {
 	assert(self != NULL);
-	++self->ref;
+
+	if (!isImmediate(self) && !(self->flags & VALUE_IMMORTAL))
+		++self->ref;
+
 	return;
 }
 
 void QxJsonValue_release(QxJsonValue *self)
 {
-	void *node, *end;
+	QxJsonValue **item, **end;
+	ObjectEntry *entry, *entryEnd;
+	Object *object;
 	assert(self != NULL);
 
-	if (self->ref)
+	if (isImmediate(self) || (self->flags & VALUE_IMMORTAL))
+	{
+		/* Immediate integer / shared static instance */
+	}
+	else if (self->ref)
 	{
 		--self->ref;
 	}
+	else if (self->flags & VALUE_ARENA)
+	{
+		/* The whole document goes away with its root */
+		if (self->flags & VALUE_ARENA_ROOT)
+			QxJsonArena_delete(containerArena(self));
+	}
 	else
 	{
 		switch (self->type)
 		{
 		case QxJsonValueTypeString:
-			assert(self->data.string);
-			free(self->data.string);
+			if (self->flags & VALUE_UTF8)
+				bufferFree(NULL, self, utf8Wide(self));
+
 			break;
 
 		case QxJsonValueTypeArray:
-			node = self->data.array.next;
-			end = &self->data.array;
+			item = valueArray(self)->items;
+			end = item + self->data.size;
 
-			while (node != end)
+			for (; item != end; ++item)
 			{
-				assert(((ArrayNode *)node)->value != NULL);
-				QxJsonValue_release(((ArrayNode *)node)->value);
-				node = ((ArrayNode *)node)->next;
-				free(((ArrayNode *)node)->previous);
+				assert(*item != NULL);
+				QxJsonValue_release(*item);
 			}
 
+			bufferFree(NULL, self, valueArray(self)->items);
 			break;
 
 		case QxJsonValueTypeObject:
-			node = self->data.object.next;
-			end = &self->data.object;
+			object = valueObject(self);
+			entry = object->entries;
+			entryEnd = entry + object->count;
 
-			while (node != end)
+			for (; entry != entryEnd; ++entry)
 			{
-				assert(((ObjectNode *)node)->key != NULL);
-				QxJsonValue_release(((ObjectNode *)node)->key);
-				assert(((ObjectNode *)node)->value != NULL);
-				QxJsonValue_release(((ObjectNode *)node)->value);
-				node = ((ObjectNode *)node)->next;
-				free(((ObjectNode *)node)->previous);
+				if (entry->key)
+				{
+					QxJsonValue_release(entry->key);
+					assert(entry->value != NULL);
+					QxJsonValue_release(entry->value);
+				}
 			}
 
+			bufferFree(NULL, self, object->entries);
+			bufferFree(NULL, self, object->slots);
 			break;
 
 		default:
+			/* Numbers are held by their block */
 			break;
 		}
 
-		free(self);
+		valueDelete(self);
 	}
 
 	return;
@@ -127,28 +323,68 @@ void QxJsonValue_release(QxJsonValue *self)
 QxJsonValueType QxJsonValue_type(QxJsonValue const *self)
 {
 	assert(self != NULL);
-	return self->type;
+	return valueType(self);
 }
 
 size_t QxJsonValue_size(QxJsonValue const *self)
 {
 	assert(self != NULL);
-	return self->size;
+
+	if (valueType(self) == QxJsonValueTypeNumber)
+		/* The union holds the number */
+		return 0;
+
+	if ((self->flags & (VALUE_UTF8 | VALUE_ASCII)) == VALUE_UTF8)
+		return utf8Units(self);
+
+	return self->data.size;
 }
 
 /* Array */
 
+static int arrayReserve(QxJsonValue *self, size_t size)
+{
+	Array *const array = valueArray(self);
+	QxJsonValue **items;
+	size_t alloc = array->alloc;
+
+	if (size <= alloc)
+		/* Enough room */
+		return 0;
+
+	if (alloc < ARRAY_MIN_ALLOC)
+		alloc = ARRAY_MIN_ALLOC;
+
+	while (alloc < size)
+		alloc *= 2;
+
+	items = (QxJsonValue **)bufferRealloc(array->arena, self, array->items,
+		array->alloc * sizeof(QxJsonValue *), alloc * sizeof(QxJsonValue *));
+
+	if (!items)
+		/* Out of memory */
+		return -1;
+
+	array->items = items;
+	array->alloc = alloc;
+	return 0;
+}
+
 QxJsonValue *QxJsonValue_arrayNew(void)
 {
-	ArrayNode *head;
-	QxJsonValue *const instance = QxJsonValue_alloc();
+	return QxJsonValue_arrayNewIn(NULL);
+}
+
+QxJsonValue *QxJsonValue_arrayNewIn(QxJsonMemory const *memory)
+{
+	QxJsonValue *const instance = valueNew(memory, QxJsonValueTypeArray,
+		sizeof(Array));
 
 	if (instance)
 	{
-		QxJsonValue_init(instance, QxJsonValueTypeArray);
-		head = &instance->data.array;
-		instance->data.array.next = head;
-		instance->data.array.previous = head;
+		valueArray(instance)->items = NULL;
+		valueArray(instance)->alloc = 0;
+		valueArray(instance)->arena = memory ? memory->arena : NULL;
 	}
 
 	return instance;
@@ -159,31 +395,24 @@ int QxJsonValue_arrayAppend(QxJsonValue *self, QxJsonValue *value)
 	int const r = QxJsonValue_arrayAppendNew(self, value);
 
 	if (r == 0)
-		++value->ref;
+		QxJsonValue_retains(value);
 
 	return r;
 }
 
 int QxJsonValue_arrayAppendNew(QxJsonValue *self, QxJsonValue *value)
 {
-	ArrayNode *node;
-
-	if (!self || self->type != QxJsonValueTypeArray || !value)
+	if (!self || valueType(self) != QxJsonValueTypeArray || !value)
 		/* Invalid argument */
 		return -1;
 
-	node = ArrayNode_alloc();
-
-	if (!node)
+	if (arrayReserve(self, self->data.size + 1) != 0
+		|| containerAdopt(valueArray(self)->arena, value) != 0)
 		/* Out of memory */
 		return -1;
 
-	node->value = value;
-	node->next = &self->data.array;
-	node->previous = self->data.array.previous;
-	node->next->previous = node;
-	node->previous->next = node;
-	++self->size;
+	valueArray(self)->items[self->data.size] = value;
+	++self->data.size;
 	return 0;
 }
 
@@ -194,25 +423,7 @@ int QxJsonValue_arrayPrepend(QxJsonValue *self, QxJsonValue *value)
 
 int QxJsonValue_arrayPrependNew(QxJsonValue *self, QxJsonValue *value)
 {
-	ArrayNode *node;
-
-	if (!self || !value || self == value || self->type != QxJsonValueTypeArray)
-		/* Invalid argument */
-		return -1;
-
-	node = ArrayNode_alloc();
-
-	if (!node)
-		/* Out of memory */
-		return -1;
-
-	node->value = value;
-	node->next = self->data.array.next;
-	node->previous = &self->data.array;
-	node->next->previous = node;
-	node->previous->next = node;
-	++self->size;
-	return 0;
+	return QxJsonValue_arrayInsertNew(self, 0, value);
 }
 
 int QxJsonValue_arrayInsert(QxJsonValue *self, size_t index,  QxJsonValue *value)
@@ -220,85 +431,55 @@ int QxJsonValue_arrayInsert(QxJsonValue *self, size_t index,  QxJsonValue *value
 	int const r = QxJsonValue_arrayInsertNew(self, index, value);
 
 	if (r == 0)
-		++value->ref;
+		QxJsonValue_retains(value);
 
 	return r;
 }
 
 int QxJsonValue_arrayInsertNew(QxJsonValue *self, size_t index, QxJsonValue *value)
 {
-	ArrayNode *node, *next;
+	QxJsonValue **items;
 
-	if (index == 0)
-		return QxJsonValue_arrayPrependNew(self, value);
-
-	if (!self || !value || self == value || self->type != QxJsonValueTypeArray || index > self->size)
+	if (!self || !value || self == value || valueType(self) != QxJsonValueTypeArray || index > self->data.size)
 		/* Invalid argument / out of bound */
 		return -1;
 
-	next = self->data.array.next;
-
-	for (; index; --index)
-	{
-		assert(next != NULL);
-		next = next->next;
-	}
-
-	node = ArrayNode_alloc();
-
-	if (!node)
+	if (arrayReserve(self, self->data.size + 1) != 0
+		|| containerAdopt(valueArray(self)->arena, value) != 0)
 		/* Out of memory */
 		return -1;
 
-	node->value = value;
-	node->next = next;
-	node->previous = next->previous;
-	node->next->previous = node;
-	node->previous->next = node;
-	++self->size;
+	items = valueArray(self)->items;
+	memmove(items + index + 1, items + index,
+		(self->data.size - index) * sizeof(QxJsonValue *));
+	items[index] = value;
+	++self->data.size;
 	return 0;
 }
 
 QxJsonValue const *QxJsonValue_arrayGet(QxJsonValue const *self, size_t index)
 {
-	ArrayNode *node;
-
-	if (!self || self->type != QxJsonValueTypeArray || index >= self->size)
+	if (!self || valueType(self) != QxJsonValueTypeArray || index >= self->data.size)
 		/* Invalid argument / Index out of range */
 		return NULL;
 
-	node = self->data.array.next;
-
-	for (; index; --index)
-	{
-		assert(node != NULL);
-		node = node->next;
-	}
-
-	assert(node != NULL);
-	assert(node->value != NULL);
-	return node->value;
+	assert(valueArray(self)->items[index] != NULL);
+	return valueArray(self)->items[index];
 }
 
 int QxJsonValue_arrayEach(QxJsonValue *self,
 	int (*callback)(size_t, QxJsonValue *, void *), void *ptr)
 {
-	ArrayNode *end;
-	ArrayNode *node;
 	size_t index;
 	int error;
 
-	if (!self || self->type != QxJsonValueTypeArray)
+	if (!self || valueType(self) != QxJsonValueTypeArray)
 		/* Invalid argument */
 		return -1;
 
-	end = &self->data.array;
-	node = end->next;
-	index = 0;
-
-	for (; node != end; node = node->next, ++index)
+	for (index = 0; index < self->data.size; ++index)
 	{
-		error = (*callback)(index, node->value, ptr);
+		error = (*callback)(index, valueArray(self)->items[index], ptr);
 
 		if (error)
 			return error;
@@ -311,278 +492,1258 @@ int QxJsonValue_arrayEach(QxJsonValue *self,
 
 QxJsonValue *QxJsonValue_falseNew(void)
 {
-	QxJsonValue *const instance = QxJsonValue_alloc();
-
-	if (instance)
-		QxJsonValue_init(instance, QxJsonValueTypeFalse);
+	return QxJsonValue_falseNewIn(NULL);
+}
 
-	return instance;
+QxJsonValue *QxJsonValue_falseNewIn(QxJsonMemory const *memory)
+{
+	(void)memory;
+	return &valueFalse;
 }
 
 /* Null */
 
 QxJsonValue *QxJsonValue_nullNew(void)
 {
-	QxJsonValue *const instance = QxJsonValue_alloc();
-
-	if (instance)
-		QxJsonValue_init(instance, QxJsonValueTypeNull);
+	return QxJsonValue_nullNewIn(NULL);
+}
 
-	return instance;
+QxJsonValue *QxJsonValue_nullNewIn(QxJsonMemory const *memory)
+{
+	(void)memory;
+	return &valueNull;
 }
 
 /* Number */
 
 QxJsonValue *QxJsonValue_numberNew(double value)
+{
+	return QxJsonValue_numberNewIn(NULL, value);
+}
+
+QxJsonValue *QxJsonValue_numberNewIn(QxJsonMemory const *memory, double value)
 {
 	QxJsonValue *instance = NULL;
 
 	if (isfinite(value))
 	{
-		instance = QxJsonValue_alloc();
+		instance = valueNew(memory, QxJsonValueTypeNumber, 0);
 
 		if (instance)
-		{
-			QxJsonValue_init(instance, QxJsonValueTypeNumber);
-			instance->data.number = value;
-		}
+			instance->data.real = value;
 	}
 
 	return instance;
 }
 
-double QxJsonValue_numberValue(QxJsonValue const *self)
+QxJsonValue *QxJsonValue_numberNewInt64(int64_t value)
 {
-	if (!self || self->type != QxJsonValueTypeNumber)
-		/* Invalid argument */
-		return NAN;
-
-	return self->data.number;
+	return QxJsonValue_numberNewInt64In(NULL, value);
 }
 
-/* Object */
-
-QxJsonValue *QxJsonValue_objectNew(void)
+QxJsonValue *QxJsonValue_numberNewInt64In(QxJsonMemory const *memory, int64_t value)
 {
-	QxJsonValue *const instance = QxJsonValue_alloc();
+	QxJsonValue *instance;
+
+	if (value >= IMMEDIATE_MIN && value <= IMMEDIATE_MAX)
+		/* No allocation */
+		return immediateNew(value);
+
+	instance = valueNew(memory, QxJsonValueTypeNumber, 0);
 
 	if (instance)
 	{
-		QxJsonValue_init(instance, QxJsonValueTypeObject);
-		instance->data.object.next = &instance->data.object;
-		instance->data.object.previous = &instance->data.object;
+		instance->flags |= VALUE_INT64;
+		instance->data.integer = value;
 	}
 
 	return instance;
 }
 
-static int compareKey(QxJsonValue const *first, QxJsonValue const *last)
+QxJsonValue *QxJsonValue_numberNewUint64(uint64_t value)
 {
-	size_t keySize;
-	wchar_t const *firstData, *lastData;
-
-	assert(first != NULL);
-	assert(last != NULL);
-	assert(QX_JSON_IS_STRING(first));
-	assert(QX_JSON_IS_STRING(last));
-
-	if (first == last)
-		/* Same instance */
-		return 1;
+	return QxJsonValue_numberNewUint64In(NULL, value);
+}
 
-	keySize = first->size;
+QxJsonValue *QxJsonValue_numberNewUint64In(QxJsonMemory const *memory, uint64_t value)
+{
+	QxJsonValue *instance;
 
-	if (keySize != last->size)
-		/* Different sizes */
-		return 0;
+	if (value <= INT64_MAX)
+		/* Signed integers are preferred */
+		return QxJsonValue_numberNewInt64In(memory, (int64_t)value);
 
-	firstData = first->data.string;
-	lastData = last->data.string;
+	instance = valueNew(memory, QxJsonValueTypeNumber, 0);
 
-	for (; keySize; --keySize, ++firstData, ++lastData)
+	if (instance)
 	{
-		if (*firstData != *lastData)
-			/* Different data */
-			return 0;
+		instance->flags |= VALUE_UINT64;
+		instance->data.unsignedInteger = value;
 	}
 
-	return 1;
+	return instance;
 }
 
-int QxJsonValue_objectSet(QxJsonValue *self, QxJsonValue *key, QxJsonValue *value)
+QxJsonValue *QxJsonValue_numberNewTextIn(QxJsonMemory const *memory,
+	wchar_t const *text, size_t size)
 {
-	ObjectNode *node, *end;
-
-	if (!self || !key || !value
-		|| self->type != QxJsonValueTypeObject
-		|| key->type != QxJsonValueTypeString)
-		/* Invalid argument */
-		return -1;
-
-	end = &self->data.object;
-	node = end->next;
+	QxJsonValue *const instance = valueNew(memory, QxJsonValueTypeNumber,
+		sizeof(size_t) + sizeof(wchar_t) * (size + 1));
 
-	for (; node != end; node = node->next)
+	if (instance)
 	{
-		if (compareKey(node->key, key))
-		{
-			/* Existing key */
-			QxJsonValue_retains(value);
-			QxJsonValue_release(node->value);
-			node->value = value;
-			return 0;
-		}
+		memcpy(numberText(instance), text, sizeof(wchar_t) * size);
+		numberText(instance)[size] = L'\0';
+		numberTextSize(instance) = size;
+		instance->flags |= VALUE_LAZY | VALUE_TEXT;
 	}
 
-	/* New key */
-	end = ObjectNode_alloc();
+	return instance;
+}
 
-	if (!end)
-		/* Failed to allocate memory */
-		return -1;
+/* Decode a lazy number, once it succeeds */
+static int numberDecode(QxJsonValue const *self)
+{
+	/* Caching the decoded value does not change the number. Not synchronized,
+	 * as documented with QX_JSON_PARSER_LAZY_NUMBERS. */
+	QxJsonValue *const number = (QxJsonValue *)self;
+	QxJsonNumber state;
+	uint64_t magnitude;
 
-	/* Insert the new node */
-	end->previous = node;
-	end->next = node->next;
-	node->next = end;
-	end->next->previous = end;
+	QxJsonNumber_scan(&state, numberText(self), numberTextSize(self));
 
-	/* Initialize it */
-	end->key = key;
-	end->value = value;
-	QxJsonValue_retains((QxJsonValue *)key);
-	QxJsonValue_retains(value);
-	++self->size;
+	if (QxJsonNumber_toInteger(&state, numberText(self), numberTextSize(self),
+			&magnitude) != 0)
+	{
+		if (QxJsonNumber_toDouble(&state, valueAllocator(self),
+				numberText(self), numberTextSize(self), &number->data.real) != 0)
+			/* Out of memory */
+			return -1;
+	}
+	else if (state.negative)
+	{
+		number->flags |= VALUE_INT64;
+		number->data.integer = -(int64_t)(magnitude - 1) - 1;
+	}
+	else if (magnitude <= INT64_MAX)
+	{
+		number->flags |= VALUE_INT64;
+		number->data.integer = (int64_t)magnitude;
+	}
+	else
+	{
+		number->flags |= VALUE_UINT64;
+		number->data.unsignedInteger = magnitude;
+	}
 
+	number->flags &= ~VALUE_LAZY;
 	return 0;
 }
 
-int QxJsonValue_objectUnset(QxJsonValue *self, QxJsonValue *key)
+double QxJsonValue_numberValue(QxJsonValue const *self)
 {
-	ObjectNode *node, *end;
-
-	if (!self || !key
-		|| self->type != QxJsonValueTypeObject
-		|| key->type != QxJsonValueTypeString)
+	if (!self || valueType(self) != QxJsonValueTypeNumber)
 		/* Invalid argument */
-		return -1;
+		return NAN;
 
-	end = &self->data.object;
-	node = end->next;
+	if (isImmediate(self))
+		return (double)immediateValue(self);
 
-	for (; node != end; node = node->next)
-	{
-		if (compareKey(node->key, key))
-		{
-			/* Key found */
-			node->next->previous = node->previous;
-			node->previous->next = node->next;
-			ObjectNode_delete(node);
-			--self->size;
-			break;
-		}
-	}
+	if ((self->flags & VALUE_LAZY) && numberDecode(self) != 0)
+		/* Out of memory */
+		return NAN;
 
-	return 0;
+	if (self->flags & VALUE_INT64)
+		return (double)self->data.integer;
+
+	if (self->flags & VALUE_UINT64)
+		return (double)self->data.unsignedInteger;
+
+	return self->data.real;
 }
 
-int QxJsonValue_objectGet(QxJsonValue *self, const QxJsonValue *key,
-	QxJsonValue **value)
+int QxJsonValue_numberIsInteger(QxJsonValue const *self)
 {
-	ObjectNode *node, *end;
-
-	if (!self || self->type != QxJsonValueTypeObject
-		|| !key || key->type != QxJsonValueTypeString || !value)
+	if (!self || valueType(self) != QxJsonValueTypeNumber)
 		/* Invalid argument */
-		return -1;
+		return 0;
 
-	end = &self->data.object;
-	node = end->next;
+	if (isImmediate(self))
+		return 1;
 
-	for (; node != end; node = node->next)
-		if (compareKey(node->key, key))
-		{
-			*value = node->value;
-			return 0;
-		}
+	if ((self->flags & VALUE_LAZY) && numberDecode(self) != 0)
+		/* Out of memory */
+		return 0;
 
-	/* Not found */
-	*value = NULL;
-	return -1;
+	return (self->flags & (VALUE_INT64 | VALUE_UINT64)) != 0;
 }
 
-int QxJsonValue_objectEach(QxJsonValue *self,
-	int (*callback)(QxJsonValue const *, QxJsonValue *, void *), void *ptr)
+int QxJsonValue_numberInt64(QxJsonValue const *self, int64_t *value)
 {
-	ObjectNode *end;
-	ObjectNode *node;
-	int error;
+	double number;
 
-	if (!self || self->type != QxJsonValueTypeObject || !callback)
+	if (!self || valueType(self) != QxJsonValueTypeNumber || !value)
 		/* Invalid argument */
 		return -1;
 
-	end = &self->data.object;
-	node = end->next;
-
-	for (; node != end; node = node->next)
+	if (isImmediate(self))
 	{
-		error = (*callback)(node->key, node->value, ptr);
+		*value = immediateValue(self);
+		return 0;
+	}
 
-		if (error)
-			return error;
+	if ((self->flags & VALUE_LAZY) && numberDecode(self) != 0)
+		/* Out of memory */
+		return -1;
+
+	if (self->flags & VALUE_INT64)
+	{
+		*value = self->data.integer;
+		return 0;
 	}
 
+	if (self->flags & VALUE_UINT64)
+		/* Beyond INT64_MAX */
+		return -1;
+
+	number = self->data.real;
+
+	if (!(number > -EXACT_DOUBLE && number < EXACT_DOUBLE)
+		|| (double)(int64_t)number != number)
+		/* Not an exact integer */
+		return -1;
+
+	*value = (int64_t)number;
 	return 0;
 }
 
-/* String */
-
-QxJsonValue *QxJsonValue_stringNew(wchar_t const *data, size_t size)
+int QxJsonValue_numberUint64(QxJsonValue const *self, uint64_t *value)
 {
-	QxJsonValue *instance = NULL;
+	double number;
 
-	if (data)
-	{
-		instance = QxJsonValue_alloc();
+	if (!self || valueType(self) != QxJsonValueTypeNumber || !value)
+		/* Invalid argument */
+		return -1;
 
-		if (instance)
-		{
-			QxJsonValue_init(instance, QxJsonValueTypeString);
-			instance->size = size;
-			instance->data.string = (wchar_t *)malloc(sizeof(wchar_t) * (size + 1));
-			instance->data.string[size] = L'\0';
+	if (isImmediate(self))
+	{
+		if (immediateValue(self) < 0)
+			/* Negative integer */
+			return -1;
 
-			while (size)
-			{
-				--size;
-				instance->data.string[size] = data[size];
-			}
-		}
+		*value = (uint64_t)immediateValue(self);
+		return 0;
 	}
 
-	return instance;
-}
+	if ((self->flags & VALUE_LAZY) && numberDecode(self) != 0)
+		/* Out of memory */
+		return -1;
 
-wchar_t const *QxJsonValue_stringValue(QxJsonValue const *self)
-{
-	assert(self != NULL);
+	if (self->flags & VALUE_UINT64)
+	{
+		*value = self->data.unsignedInteger;
+		return 0;
+	}
 
-	if (self->type != QxJsonValueTypeString)
-		return NULL;
+	if (self->flags & VALUE_INT64)
+	{
+		if (self->data.integer < 0)
+			/* Negative integer */
+			return -1;
 
-	assert(self->data.string != NULL);
-	return self->data.string;
-}
+		*value = (uint64_t)self->data.integer;
+		return 0;
+	}
 
-/* True */
+	number = self->data.real;
 
-QxJsonValue *QxJsonValue_trueNew(void)
+	if (!(number >= 0 && number < EXACT_DOUBLE)
+		|| (double)(uint64_t)number != number)
+		/* Not an exact integer */
+		return -1;
+
+	*value = (uint64_t)number;
+	return 0;
+}
+
+wchar_t const *QxJsonValue_numberText(QxJsonValue const *self, size_t *size)
+{
+	if (!self || valueType(self) != QxJsonValueTypeNumber || isImmediate(self)
+		|| !(self->flags & VALUE_TEXT))
+		/* Invalid argument / not parsed lazily */
+		return NULL;
+
+	if (size)
+		*size = numberTextSize(self);
+
+	return numberText(self);
+}
+
+/* Object */
+
+/* SipHash-1-3 over the code units of a key, keyed with a per process seed so
+ * that colliding keys cannot be crafted in advance. */
+
+#define ROTL64(x, b) (((x) << (b)) | ((x) >> (64 - (b))))
+#define SIPROUND(v) do { \
+	v[0] += v[1]; v[1] = ROTL64(v[1], 13); v[1] ^= v[0]; v[0] = ROTL64(v[0], 32); \
+	v[2] += v[3]; v[3] = ROTL64(v[3], 16); v[3] ^= v[2]; \
+	v[0] += v[3]; v[3] = ROTL64(v[3], 21); v[3] ^= v[0]; \
+	v[2] += v[1]; v[1] = ROTL64(v[1], 17); v[1] ^= v[2]; v[2] = ROTL64(v[2], 32); \
+} while (0)
+
+typedef struct HashState
+{
+	uint64_t v[4];
+	uint64_t tail;
+	size_t length;
+} HashState;
+
+static uint64_t hashSeed[2];
+static pthread_once_t hashSeedOnce = PTHREAD_ONCE_INIT;
+
+static void hashSeedInit(void)
+{
+	int fd;
+	ssize_t got = 0;
+
+	fd = open("/dev/urandom", O_RDONLY);
+
+	if (fd >= 0)
+	{
+		got = read(fd, hashSeed, sizeof(hashSeed));
+		close(fd);
+	}
+
+	if (got != (ssize_t)sizeof(hashSeed))
+	{
+		/* Poor man's entropy */
+		hashSeed[0] = (uint64_t)time(NULL) ^ ((uint64_t)getpid() << 32);
+		hashSeed[1] = (uint64_t)(size_t)&hashSeed ^ (uint64_t)clock();
+	}
+}
+
+static void hashInit(HashState *state)
+{
+	pthread_once(&hashSeedOnce, &hashSeedInit);
+	state->v[0] = hashSeed[0] ^ UINT64_C(0x736f6d6570736575);
+	state->v[1] = hashSeed[1] ^ UINT64_C(0x646f72616e646f6d);
+	state->v[2] = hashSeed[0] ^ UINT64_C(0x6c7967656e657261);
+	state->v[3] = hashSeed[1] ^ UINT64_C(0x7465646279746573);
+	state->tail = 0;
+	state->length = 0;
+}
+
+static void hashUnit(HashState *state, uint32_t unit)
+{
+	uint64_t word;
+
+	if (!(state->length & 1))
+	{
+		/* First half of a word */
+		state->tail = unit;
+		++state->length;
+		return;
+	}
+
+	word = state->tail | ((uint64_t)unit << 32);
+	++state->length;
+	state->v[3] ^= word;
+	SIPROUND(state->v);
+	state->v[0] ^= word;
+}
+
+static size_t hashFinal(HashState *state)
+{
+	uint64_t word = (uint64_t)(state->length * 4) << 56;
+
+	if (state->length & 1)
+		word |= state->tail;
+
+	state->v[3] ^= word;
+	SIPROUND(state->v);
+	state->v[0] ^= word;
+	state->v[2] ^= 0xff;
+	SIPROUND(state->v);
+	SIPROUND(state->v);
+	SIPROUND(state->v);
+	return (size_t)(state->v[0] ^ state->v[1] ^ state->v[2] ^ state->v[3]);
+}
+
+static size_t hashKey(wchar_t const *data, size_t size)
+{
+	HashState state;
+
+	hashInit(&state);
+
+	for (; size; --size, ++data)
+		hashUnit(&state, (uint32_t)*data);
+
+	return hashFinal(&state);
+}
+
+/* Decode the next code point of an UTF-8 sequence */
+static int utf8Decode(unsigned char const **data, unsigned char const *end,
+	uint32_t *code)
+{
+	unsigned char const *it = *data;
+	uint32_t min;
+	int pending;
+
+	if (*it < 0x80)
+	{
+		*code = *it;
+		*data = it + 1;
+		return 0;
+	}
+	else if (*it >= 0xC2 && *it <= 0xDF)
+	{
+		*code = *it & 0x1F;
+		min = 0x80;
+		pending = 1;
+	}
+	else if (*it >= 0xE0 && *it <= 0xEF)
+	{
+		*code = *it & 0x0F;
+		min = 0x800;
+		pending = 2;
+	}
+	else if (*it >= 0xF0 && *it <= 0xF4)
+	{
+		*code = *it & 0x07;
+		min = 0x10000;
+		pending = 3;
+	}
+	else
+	{
+		/* Invalid leading byte */
+		*code = 0;
+		return -1;
+	}
+
+	for (++it; pending; --pending, ++it)
+	{
+		if (it == end || (*it & 0xC0) != 0x80)
+			/* Truncated sequence */
+			return -1;
+
+		*code = (*code << 6) | (*it & 0x3F);
+	}
+
+	if (*code < min || *code > 0x10FFFF || (*code >= 0xD800 && *code <= 0xDFFF))
+		/* Overlong encoding / out of range / surrogate */
+		return -1;
+
+	*data = it;
+	return 0;
+}
+
+/* Split a code point into wide characters */
+static int codeToWide(uint32_t code, wchar_t *units)
+{
+#if WCHAR_MAX < 0x10FFFF
+	if (code >= 0x10000)
+	{
+		code -= 0x10000;
+		units[0] = (wchar_t)(0xD800 | (code >> 10));
+		units[1] = (wchar_t)(0xDC00 | (code & 0x3FF));
+		return 2;
+	}
+#endif
+
+	units[0] = (wchar_t)code;
+	return 1;
+}
+
+static int hashUtf8(char const *data, size_t size, size_t *hash)
 {
-	QxJsonValue *const instance = QxJsonValue_alloc();
+	unsigned char const *it = (unsigned char const *)data;
+	unsigned char const *const end = it + size;
+	HashState state;
+	wchar_t units[2];
+	uint32_t code;
+	int count;
+
+	hashInit(&state);
+
+	while (it != end)
+	{
+		if (utf8Decode(&it, end, &code) != 0)
+			/* Invalid UTF-8 */
+			return -1;
+
+		count = codeToWide(code, units);
+		hashUnit(&state, (uint32_t)units[0]);
+
+		if (count == 2)
+			hashUnit(&state, (uint32_t)units[1]);
+	}
+
+	*hash = hashFinal(&state);
+	return 0;
+}
+
+QxJsonValue *QxJsonValue_objectNew(void)
+{
+	return QxJsonValue_objectNewIn(NULL);
+}
+
+QxJsonValue *QxJsonValue_objectNewIn(QxJsonMemory const *memory)
+{
+	QxJsonValue *const instance = valueNew(memory, QxJsonValueTypeObject,
+		sizeof(Object));
 
 	if (instance)
-		QxJsonValue_init(instance, QxJsonValueTypeTrue);
+	{
+		memset(valueObject(instance), 0, sizeof(Object));
+		valueObject(instance)->arena = memory ? memory->arena : NULL;
+	}
 
 	return instance;
 }
+
+/* A key being looked up, either wide or UTF-8 encoded */
+typedef struct KeyRef
+{
+	wchar_t const *data;
+	char const *utf8;
+	size_t size;
+	size_t hash;
+} KeyRef;
+
+/* Refer to a key string, hashing it */
+static void keyRef(QxJsonValue const *key, KeyRef *ref)
+{
+	ref->size = key->data.size;
+
+	if (key->flags & VALUE_UTF8)
+	{
+		ref->data = NULL;
+		ref->utf8 = utf8Text(key);
+		/* Valid by construction */
+		hashUtf8(ref->utf8, ref->size, &ref->hash);
+		return;
+	}
+
+	ref->data = valueString(key);
+	ref->utf8 = NULL;
+	ref->hash = hashKey(ref->data, ref->size);
+}
+
+/* Whether UTF-8 bytes and wide characters hold the same text */
+static int equalUtf8Wide(char const *data, size_t size,
+	wchar_t const *wide, size_t wideSize)
+{
+	unsigned char const *it = (unsigned char const *)data;
+	unsigned char const *const end = it + size;
+	wchar_t const *const wideEnd = wide + wideSize;
+	wchar_t units[2];
+	uint32_t code;
+	int count;
+
+	while (it != end)
+	{
+		if (utf8Decode(&it, end, &code) != 0)
+			/* Invalid UTF-8 */
+			return 0;
+
+		count = codeToWide(code, units);
+
+		if (wideEnd - wide < count || wide[0] != units[0]
+			|| (count == 2 && wide[1] != units[1]))
+			/* Different data */
+			return 0;
+
+		wide += count;
+	}
+
+	return wide == wideEnd;
+}
+
+static int compareKey(ObjectEntry const *entry, KeyRef const *ref)
+{
+	QxJsonValue const *const key = entry->key;
+
+	if (!key || entry->hash != ref->hash)
+		/* Removed entry / different hashes */
+		return 0;
+
+	if (key->flags & VALUE_UTF8)
+	{
+		if (ref->data)
+			return equalUtf8Wide(utf8Text(key), key->data.size, ref->data, ref->size);
+
+		return key->data.size == ref->size
+			&& memcmp(utf8Text(key), ref->utf8, ref->size) == 0;
+	}
+
+	if (!ref->data)
+		return equalUtf8Wide(ref->utf8, ref->size, valueString(key), key->data.size);
+
+	if (key->data.size != ref->size)
+		/* Different sizes */
+		return 0;
+
+	return valueString(key) == ref->data
+		|| memcmp(valueString(key), ref->data, ref->size * sizeof(wchar_t)) == 0;
+}
+
+static ObjectEntry *objectFind(Object const *object, KeyRef const *ref,
+	size_t **slot)
+{
+	ObjectEntry *entry, *end;
+	size_t offset;
+
+	if (!object->mask)
+	{
+		/* Small object: linear scan */
+		entry = object->entries;
+		end = entry + object->count;
+
+		for (; entry != end; ++entry)
+			if (compareKey(entry, ref))
+				return entry;
+
+		return NULL;
+	}
+
+	/* Linear probing */
+	offset = ref->hash & object->mask;
+
+	for (;; offset = (offset + 1) & object->mask)
+	{
+		if (object->slots[offset] == SLOT_EMPTY)
+			/* Not found */
+			return NULL;
+
+		if (object->slots[offset] != SLOT_REMOVED)
+		{
+			entry = object->entries + object->slots[offset] - 1;
+
+			if (compareKey(entry, ref))
+			{
+				*slot = object->slots + offset;
+				return entry;
+			}
+		}
+	}
+}
+
+static void objectIndex(Object *object, size_t position)
+{
+	size_t offset = object->entries[position].hash & object->mask;
+
+	while (object->slots[offset] != SLOT_EMPTY
+		&& object->slots[offset] != SLOT_REMOVED)
+		offset = (offset + 1) & object->mask;
+
+	object->slots[offset] = position + 1;
+}
+
+static int objectGrow(QxJsonValue *self)
+{
+	Object *const object = valueObject(self);
+	ObjectEntry *entries;
+	size_t *slots = NULL;
+	size_t alloc = object->alloc;
+	size_t from, to;
+
+	if (self->data.size * 2 >= alloc)
+		/* Not enough removed entries to make room: double the storage */
+		alloc = alloc < OBJECT_MIN_ALLOC ? OBJECT_MIN_ALLOC : alloc * 2;
+
+	if (alloc > OBJECT_INDEX_THRESHOLD)
+	{
+		slots = (size_t *)bufferRealloc(object->arena, self, NULL, 0,
+			alloc * 2 * sizeof(size_t));
+
+		if (!slots)
+			/* Out of memory */
+			return -1;
+
+		memset(slots, 0, alloc * 2 * sizeof(size_t));
+	}
+
+	entries = (ObjectEntry *)bufferRealloc(object->arena, self, object->entries,
+		object->alloc * sizeof(ObjectEntry), alloc * sizeof(ObjectEntry));
+
+	if (!entries)
+	{
+		/* Out of memory */
+		bufferFree(object->arena, self, slots);
+		return -1;
+	}
+
+	/* Drop the removed entries, keeping the insertion order */
+	for (from = to = 0; from != object->count; ++from)
+		if (entries[from].key)
+			entries[to++] = entries[from];
+
+	assert(to == self->data.size);
+	bufferFree(object->arena, self, object->slots);
+	object->entries = entries;
+	object->count = to;
+	object->alloc = alloc;
+	object->slots = slots;
+	object->mask = slots ? alloc * 2 - 1 : 0;
+
+	if (slots)
+		for (from = 0; from != to; ++from)
+			objectIndex(object, from);
+
+	return 0;
+}
+
+int QxJsonValue_objectSet(QxJsonValue *self, QxJsonValue *key, QxJsonValue *value)
+{
+	Object *object;
+	ObjectEntry *entry;
+	size_t *slot = NULL;
+	KeyRef ref;
+
+	if (!self || !key || !value
+		|| valueType(self) != QxJsonValueTypeObject
+		|| valueType(key) != QxJsonValueTypeString)
+		/* Invalid argument */
+		return -1;
+
+	object = valueObject(self);
+	keyRef(key, &ref);
+	entry = objectFind(object, &ref, &slot);
+
+	if (entry)
+	{
+		/* Existing key */
+		QxJsonValue_retains(value);
+
+		if (containerAdopt(object->arena, value) != 0)
+		{
+			/* Failed to allocate memory */
+			QxJsonValue_release(value);
+			return -1;
+		}
+
+		if (!object->arena)
+			QxJsonValue_release(entry->value);
+
+		entry->value = value;
+		return 0;
+	}
+
+	/* New key */
+	if (object->count == object->alloc && objectGrow(self) != 0)
+		/* Failed to allocate memory */
+		return -1;
+
+	if (object->arena && QxJsonArena_reserve(object->arena, 2) != 0)
+		/* Failed to allocate memory */
+		return -1;
+
+	/* Cannot fail once reserved */
+	QxJsonValue_retains(key);
+	QxJsonValue_retains(value);
+	containerAdopt(object->arena, key);
+	containerAdopt(object->arena, value);
+
+	entry = object->entries + object->count;
+	entry->key = key;
+	entry->value = value;
+	entry->hash = ref.hash;
+
+	if (object->mask)
+		objectIndex(object, object->count);
+
+	++object->count;
+	++self->data.size;
+
+	return 0;
+}
+
+int QxJsonValue_objectUnset(QxJsonValue *self, QxJsonValue *key)
+{
+	Object *object;
+	ObjectEntry *entry;
+	size_t *slot = NULL;
+	KeyRef ref;
+
+	if (!self || !key
+		|| valueType(self) != QxJsonValueTypeObject
+		|| valueType(key) != QxJsonValueTypeString)
+		/* Invalid argument */
+		return -1;
+
+	object = valueObject(self);
+	keyRef(key, &ref);
+	entry = objectFind(object, &ref, &slot);
+
+	if (entry)
+	{
+		/* Key found */
+		if (!object->arena)
+		{
+			QxJsonValue_release(entry->key);
+			QxJsonValue_release(entry->value);
+		}
+
+		entry->key = NULL;
+		entry->value = NULL;
+		--self->data.size;
+
+		if (slot)
+			*slot = SLOT_REMOVED;
+
+		if (!self->data.size)
+		{
+			/* Start over from a clean storage */
+			object->count = 0;
+
+			if (object->slots)
+				memset(object->slots, 0, (object->mask + 1) * sizeof(size_t));
+		}
+	}
+
+	return 0;
+}
+
+static int objectGet(QxJsonValue *self, KeyRef const *ref, QxJsonValue **value)
+{
+	ObjectEntry *entry;
+	size_t *slot;
+
+	entry = objectFind(valueObject(self), ref, &slot);
+
+	if (entry)
+	{
+		*value = entry->value;
+		return 0;
+	}
+
+	/* Not found */
+	*value = NULL;
+	return -1;
+}
+
+int QxJsonValue_objectGet(QxJsonValue *self, const QxJsonValue *key,
+	QxJsonValue **value)
+{
+	KeyRef ref;
+
+	if (!self || valueType(self) != QxJsonValueTypeObject
+		|| !key || valueType(key) != QxJsonValueTypeString || !value)
+		/* Invalid argument */
+		return -1;
+
+	keyRef(key, &ref);
+	return objectGet(self, &ref, value);
+}
+
+int QxJsonValue_objectGetData(QxJsonValue *self,
+	wchar_t const *data, size_t size, QxJsonValue **value)
+{
+	KeyRef ref;
+
+	if (!self || valueType(self) != QxJsonValueTypeObject || !data || !value)
+		/* Invalid argument */
+		return -1;
+
+	ref.data = data;
+	ref.size = size;
+	ref.hash = hashKey(data, size);
+	return objectGet(self, &ref, value);
+}
+
+int QxJsonValue_objectGetUtf8(QxJsonValue *self,
+	char const *data, size_t size, QxJsonValue **value)
+{
+	KeyRef ref;
+
+	if (!self || valueType(self) != QxJsonValueTypeObject || !data || !value)
+		/* Invalid argument */
+		return -1;
+
+	*value = NULL;
+	ref.data = NULL;
+	ref.utf8 = data;
+	ref.size = size;
+
+	if (hashUtf8(data, size, &ref.hash) != 0)
+		/* Invalid UTF-8 */
+		return -1;
+
+	return objectGet(self, &ref, value);
+}
+
+int QxJsonValue_objectGetKey(QxJsonValue *self, QxJsonKey *key,
+	QxJsonValue **value)
+{
+	KeyRef ref;
+
+	if (!self || valueType(self) != QxJsonValueTypeObject
+		|| !key || !key->data || !value)
+		/* Invalid argument */
+		return -1;
+
+	QxJsonKey_prepare(key);
+	ref.data = key->data;
+	ref.size = key->size;
+	ref.hash = key->hash;
+	return objectGet(self, &ref, value);
+}
+
+int QxJsonValue_objectEach(QxJsonValue *self,
+	int (*callback)(QxJsonValue const *, QxJsonValue *, void *), void *ptr)
+{
+	ObjectEntry *entry;
+	size_t offset;
+	int error;
+
+	if (!self || valueType(self) != QxJsonValueTypeObject || !callback)
+		/* Invalid argument */
+		return -1;
+
+	for (offset = 0; offset < valueObject(self)->count; ++offset)
+	{
+		entry = valueObject(self)->entries + offset;
+
+		if (!entry->key)
+			/* Removed entry */
+			continue;
+
+		error = (*callback)(entry->key, entry->value, ptr);
+
+		if (error)
+			return error;
+	}
+
+	return 0;
+}
+
+/* Key */
+
+void QxJsonKey_prepare(QxJsonKey *self)
+{
+	assert(self != NULL);
+
+	if (!self->hashed)
+	{
+		self->hash = hashKey(self->data, self->size);
+		self->hashed = 1;
+	}
+}
+
+/* Key cache */
+
+QxJsonValue *QxJsonKeyCache_get(QxJsonKeyCache *self, QxJsonMemory const *memory,
+	wchar_t const *data, size_t size, int utf8)
+{
+	QxJsonValue **slot;
+	QxJsonValue *key;
+	uint32_t hash = UINT32_C(2166136261);
+	size_t index;
+
+	if (size > QX_JSON_KEY_CACHE_MAX_SIZE)
+		/* Long keys are not shared */
+		return utf8 ? QxJsonValue_stringNewAsUtf8In(memory, data, size)
+			: QxJsonValue_stringNewIn(memory, data, size);
+
+	/* FNV-1a, enough to spread the keys of a document */
+	for (index = 0; index != size; ++index)
+		hash = (hash ^ (uint32_t)data[index]) * UINT32_C(16777619);
+
+	slot = self->keys + (hash & (QX_JSON_KEY_CACHE_SLOTS - 1));
+	key = *slot;
+
+	if (!key || !((key->flags & VALUE_UTF8)
+		? equalUtf8Wide(utf8Text(key), key->data.size, data, size)
+		: key->data.size == size
+			&& memcmp(valueString(key), data, size * sizeof(wchar_t)) == 0))
+	{
+		/* Missed */
+		key = utf8 ? QxJsonValue_stringNewAsUtf8In(memory, data, size)
+			: QxJsonValue_stringNewIn(memory, data, size);
+
+		if (!key)
+			/* Out of memory */
+			return NULL;
+
+		if (*slot)
+			QxJsonValue_release(*slot);
+		else
+			++self->count;
+
+		*slot = key;
+	}
+
+	QxJsonValue_retains(key);
+	return key;
+}
+
+void QxJsonKeyCache_clear(QxJsonKeyCache *self)
+{
+	size_t index;
+
+	for (index = 0; self->count && index != QX_JSON_KEY_CACHE_SLOTS; ++index)
+	{
+		if (self->keys[index])
+		{
+			QxJsonValue_release(self->keys[index]);
+			self->keys[index] = NULL;
+			--self->count;
+		}
+	}
+}
+
+/* String */
+
+QxJsonValue *QxJsonValue_stringNew(wchar_t const *data, size_t size)
+{
+	return QxJsonValue_stringNewIn(NULL, data, size);
+}
+
+QxJsonValue *QxJsonValue_stringNewIn(QxJsonMemory const *memory,
+	wchar_t const *data, size_t size)
+{
+	QxJsonValue *instance = NULL;
+
+	if (data)
+	{
+		instance = valueNew(memory, QxJsonValueTypeString,
+			sizeof(wchar_t) * (size + 1));
+
+		if (instance)
+		{
+			memcpy(valueString(instance), data, sizeof(wchar_t) * size);
+			valueString(instance)[size] = L'\0';
+			instance->data.size = size;
+		}
+	}
+
+	return instance;
+}
+
+/* Allocate a string of @c bytes UTF-8 bytes, to be written. The count of
+ * wide characters is only stored if they are not all ASCII. */
+static QxJsonValue *utf8StringNew(QxJsonMemory const *memory, size_t bytes,
+	size_t units)
+{
+	QxJsonArena *const arena = memory ? memory->arena : NULL;
+	int const ascii = units == bytes;
+	QxJsonValue *const instance = valueNew(memory, QxJsonValueTypeString,
+		sizeof(wchar_t *) * (arena ? 2 : 1) + (ascii ? 0 : sizeof(size_t))
+			+ bytes + 1);
+
+	if (instance)
+	{
+		instance->flags |= ascii ? VALUE_UTF8 | VALUE_ASCII : VALUE_UTF8;
+		instance->data.size = bytes;
+		utf8Wide(instance) = NULL;
+
+		if (arena)
+			utf8Arena(instance) = arena;
+
+		if (!ascii)
+			utf8Units(instance) = units;
+
+		utf8Text(instance)[bytes] = '\0';
+	}
+
+	return instance;
+}
+
+/* Encode wide characters as UTF-8, or only measure them if @c out is NULL.
+ * Returns (size_t)-1 if they cannot be decoded back as they are. */
+static size_t wideToUtf8(wchar_t const *data, size_t size, unsigned char *out)
+{
+	wchar_t const *const end = data + size;
+	uint32_t code;
+	size_t bytes = 0;
+
+	for (; data != end; ++data)
+	{
+		code = (uint32_t)*data;
+
+		if (code < 0x80)
+		{
+			if (out)
+				out[bytes] = (unsigned char)code;
+
+			++bytes;
+			continue;
+		}
+
+#if WCHAR_MAX < 0x10FFFF
+		if (code >= 0xD800 && code <= 0xDBFF && data + 1 != end
+			&& (uint32_t)data[1] >= 0xDC00 && (uint32_t)data[1] <= 0xDFFF)
+		{
+			/* Surrogate pair */
+			++data;
+			code = 0x10000 + ((code - 0xD800) << 10) + ((uint32_t)*data - 0xDC00);
+		}
+#endif
+
+		if ((code >= 0xD800 && code <= 0xDFFF) || code > 0x10FFFF)
+			/* Lone surrogate / out of range */
+			return (size_t)-1;
+
+		if (out && code < 0x800)
+		{
+			out[bytes] = (unsigned char)(0xC0 | (code >> 6));
+			out[bytes + 1] = (unsigned char)(0x80 | (code & 0x3F));
+		}
+		else if (out && code < 0x10000)
+		{
+			out[bytes] = (unsigned char)(0xE0 | (code >> 12));
+			out[bytes + 1] = (unsigned char)(0x80 | ((code >> 6) & 0x3F));
+			out[bytes + 2] = (unsigned char)(0x80 | (code & 0x3F));
+		}
+		else if (out)
+		{
+			out[bytes] = (unsigned char)(0xF0 | (code >> 18));
+			out[bytes + 1] = (unsigned char)(0x80 | ((code >> 12) & 0x3F));
+			out[bytes + 2] = (unsigned char)(0x80 | ((code >> 6) & 0x3F));
+			out[bytes + 3] = (unsigned char)(0x80 | (code & 0x3F));
+		}
+
+		bytes += code < 0x800 ? 2 : code < 0x10000 ? 3 : 4;
+	}
+
+	return bytes;
+}
+
+QxJsonValue *QxJsonValue_stringNewUtf8(char const *data, size_t size)
+{
+	return QxJsonValue_stringNewUtf8In(NULL, data, size);
+}
+
+QxJsonValue *QxJsonValue_stringNewUtf8In(QxJsonMemory const *memory,
+	char const *data, size_t size)
+{
+	unsigned char const *it = (unsigned char const *)data;
+	unsigned char const *const end = it + size;
+	QxJsonValue *instance;
+	size_t units = 0;
+	uint32_t code;
+
+	if (!data)
+		/* Invalid argument */
+		return NULL;
+
+	while (it != end)
+	{
+		if (utf8Decode(&it, end, &code) != 0)
+			/* Invalid UTF-8 */
+			return NULL;
+
+		++units;
+
+#if WCHAR_MAX < 0x10FFFF
+		if (code >= 0x10000)
+			/* Surrogate pair */
+			++units;
+#endif
+	}
+
+	instance = utf8StringNew(memory, size, units);
+
+	if (instance)
+		memcpy(utf8Text(instance), data, size);
+
+	return instance;
+}
+
+QxJsonValue *QxJsonValue_stringNewAsUtf8In(QxJsonMemory const *memory,
+	wchar_t const *data, size_t size)
+{
+	QxJsonValue *instance;
+	size_t bytes;
+
+	if (!data)
+		/* Invalid argument */
+		return NULL;
+
+	bytes = wideToUtf8(data, size, NULL);
+
+	if (bytes == (size_t)-1)
+		/* Kept as is */
+		return QxJsonValue_stringNewIn(memory, data, size);
+
+	instance = utf8StringNew(memory, bytes, size);
+
+	if (instance)
+		wideToUtf8(data, size, (unsigned char *)utf8Text(instance));
+
+	return instance;
+}
+
+/* Decode an UTF-8 string, once */
+static wchar_t const *utf8Widen(QxJsonValue const *self)
+{
+	/* Caching the wide characters does not change the string. Not
+	 * synchronized, see QX_JSON_PARSER_UTF8_STRINGS. */
+	QxJsonValue *const string = (QxJsonValue *)self;
+	unsigned char const *it = (unsigned char const *)utf8Text(self);
+	unsigned char const *const end = it + self->data.size;
+	size_t const units = QxJsonValue_size(self);
+	wchar_t *wide, *out;
+	uint32_t code;
+
+	if (self->flags & VALUE_ARENA)
+		wide = (wchar_t *)QxJsonArena_alloc(utf8Arena(self),
+			sizeof(wchar_t) * (units + 1));
+	else
+		wide = (wchar_t *)bufferRealloc(NULL, self, NULL, 0,
+			sizeof(wchar_t) * (units + 1));
+
+	if (!wide)
+		/* Out of memory */
+		return NULL;
+
+	for (out = wide; it != end; out += codeToWide(code, out))
+		utf8Decode(&it, end, &code);
+
+	*out = L'\0';
+	utf8Wide(string) = wide;
+	return wide;
+}
+
+wchar_t const *QxJsonValue_stringValue(QxJsonValue const *self)
+{
+	assert(self != NULL);
+
+	if (valueType(self) != QxJsonValueTypeString)
+		return NULL;
+
+	if (!(self->flags & VALUE_UTF8))
+		return valueString(self);
+
+	if (utf8Wide(self))
+		return utf8Wide(self);
+
+	return utf8Widen(self);
+}
+
+char const *QxJsonValue_stringUtf8(QxJsonValue const *self, size_t *size)
+{
+	if (!self || valueType(self) != QxJsonValueTypeString
+		|| !(self->flags & VALUE_UTF8))
+		/* Invalid argument / stored as wide characters */
+		return NULL;
+
+	if (size)
+		*size = self->data.size;
+
+	return utf8Text(self);
+}
+
+/* True */
+
+QxJsonValue *QxJsonValue_trueNew(void)
+{
+	return QxJsonValue_trueNewIn(NULL);
+}
+
+QxJsonValue *QxJsonValue_trueNewIn(QxJsonMemory const *memory)
+{
+	(void)memory;
+	return &valueTrue;
+}
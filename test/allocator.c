@@ -0,0 +1,334 @@
+/**
+ * @file allocator.c
+ * @brief Testing source file of the custom allocators.
+ * @author Romain DEOUX
+ */
+
+#include <stdlib.h>
+#include <wchar.h>
+
+#include <qx.json.allocator.h>
+#include <qx.json.parser.h>
+#include <qx.json.value.h>
+
+#include "expect.h"
+
+typedef struct Counter
+{
+	int blocks; /* Number of live blocks */
+	int calls;  /* Number of allocations */
+	size_t last; /* Size of the last reallocation */
+} Counter;
+
+static void *countAllocate(void *ptr, size_t size)
+{
+	void *const block = malloc(size);
+
+	if (block)
+	{
+		++((Counter *)ptr)->blocks;
+		++((Counter *)ptr)->calls;
+	}
+
+	return block;
+}
+
+static void *countReallocate(void *ptr, void *block, size_t size)
+{
+	void *const newBlock = realloc(block, size);
+
+	if (newBlock)
+	{
+		if (!block)
+			++((Counter *)ptr)->blocks;
+
+		++((Counter *)ptr)->calls;
+		((Counter *)ptr)->last = size;
+	}
+
+	return newBlock;
+}
+
+static void countDeallocate(void *ptr, void *block)
+{
+	expect_not_null(block);
+	--((Counter *)ptr)->blocks;
+	free(block);
+}
+
+static void *failAllocate(void *ptr, size_t size)
+{
+	(void)ptr;
+	(void)size;
+	return NULL;
+}
+
+static void *failReallocate(void *ptr, void *block, size_t size)
+{
+	(void)ptr;
+	(void)block;
+	(void)size;
+	return NULL;
+}
+
+static void failDeallocate(void *ptr, void *block)
+{
+	(void)ptr;
+	free(block);
+}
+
+/* Whether the toggled allocator fails */
+static int failing = 0;
+
+static void *toggleAllocate(void *ptr, size_t size)
+{
+	(void)ptr;
+	return failing ? NULL : malloc(size);
+}
+
+static void *toggleReallocate(void *ptr, void *block, size_t size)
+{
+	(void)ptr;
+	return failing ? NULL : realloc(block, size);
+}
+
+static QxJsonValue *parse(QxJsonAllocator const *allocator, unsigned int flags)
+{
+	wchar_t const *text = L"{\"list\": [1, \"two\", null, {\"three\": true}]}";
+	QxJsonParser *parser;
+	QxJsonValue *root = NULL;
+
+	parser = QxJsonParser_newWithAllocator(allocator);
+	expect_not_null(parser);
+	expect_zero(QxJsonParser_setFlags(parser, flags));
+	expect_zero(QxJsonParser_feed(parser, text, wcslen(text)));
+	expect_zero(QxJsonParser_end(parser, &root));
+	QxJsonParser_release(parser);
+
+	expect_not_null(root);
+	expect_ok(QX_JSON_IS_OBJECT(root));
+	return root;
+}
+
+static void testParser(unsigned int flags)
+{
+	Counter counter = { 0, 0, 0 };
+	QxJsonAllocator allocator;
+	QxJsonValue *root, *list;
+
+	allocator.allocate = &countAllocate;
+	allocator.reallocate = &countReallocate;
+	allocator.deallocate = &countDeallocate;
+	allocator.ptr = &counter;
+
+	root = parse(&allocator, flags);
+	expect_ok(counter.blocks > 0);
+
+	/* Values created later by the default allocator may be mixed in */
+	list = NULL;
+	expect_zero(QxJsonValue_objectGetData(root, L"list", 4, &list));
+	expect_zero(QxJsonValue_arrayAppendNew(list, QxJsonValue_nullNew()));
+
+	QxJsonValue_release(root);
+	expect_zero(counter.blocks);
+}
+
+static void testDefault(void)
+{
+	Counter counter = { 0, 0, 0 };
+	QxJsonAllocator allocator;
+	QxJsonValue *array, *string;
+
+	allocator.allocate = &countAllocate;
+	allocator.reallocate = &countReallocate;
+	allocator.deallocate = &countDeallocate;
+	allocator.ptr = &counter;
+
+	QxJson_setAllocator(&allocator);
+	expect_ok(QxJson_allocator() == &allocator);
+	array = QxJsonValue_arrayNew();
+	string = QxJsonValue_stringNew(L"string", 6);
+	expect_zero(QxJsonValue_arrayAppendNew(array, string));
+	expect_int_equal(counter.blocks, 3); /* The string holds its characters */
+
+	/* The allocator of existing values is remembered */
+	QxJson_setAllocator(NULL);
+	expect_zero(QxJsonValue_arrayAppendNew(array, QxJsonValue_trueNew()));
+	QxJsonValue_release(array);
+	expect_zero(counter.blocks);
+
+	/* Parsers use the default allocator */
+	QxJson_setAllocator(&allocator);
+	QxJsonValue_release(parse(NULL, 0));
+	QxJson_setAllocator(NULL);
+	expect_ok(counter.calls > 4);
+	expect_zero(counter.blocks);
+}
+
+static void testLiterals(void)
+{
+	Counter counter = { 0, 0, 0 };
+	QxJsonAllocator allocator;
+	QxJsonParser *parser;
+	QxJsonValue *root = NULL;
+	int index, calls;
+
+	allocator.allocate = &countAllocate;
+	allocator.reallocate = &countReallocate;
+	allocator.deallocate = &countDeallocate;
+	allocator.ptr = &counter;
+
+	parser = QxJsonParser_newWithAllocator(&allocator);
+	expect_not_null(parser);
+	calls = counter.calls;
+	expect_zero(QxJsonParser_feed(parser, L"[", 1));
+
+	for (index = 0; index < 1000; ++index)
+		expect_zero(QxJsonParser_feed(parser, L"true, false, null, -7, ", 23));
+
+	expect_zero(QxJsonParser_feed(parser, L"true]", 5));
+	expect_zero(QxJsonParser_end(parser, &root));
+	QxJsonParser_release(parser);
+
+	/* Only the parser stacks, the array and the growth of its items */
+	expect_int_equal(QxJsonValue_size(root), 4001);
+	expect_ok(counter.calls - calls < 20);
+	expect_ok(QxJsonValue_arrayGet(root, 0) == QxJsonValue_trueNew());
+	expect_double_equal(QxJsonValue_numberValue(QxJsonValue_arrayGet(root, 3)), -7);
+	QxJsonValue_release(root);
+	expect_zero(counter.blocks);
+
+	/* No allocator is involved */
+	QxJson_setAllocator(&allocator);
+	calls = counter.calls;
+	expect_ok(QxJsonValue_nullNew() == QxJsonValue_nullNew());
+	QxJsonValue_release(QxJsonValue_falseNew());
+	QxJson_setAllocator(NULL);
+	expect_int_equal(counter.calls, calls);
+}
+
+static void testTokenBuffer(void)
+{
+	Counter counter = { 0, 0, 0 };
+	QxJsonAllocator allocator;
+	QxJsonParser *parser;
+	QxJsonValue *root = NULL;
+	wchar_t chunk[1000];
+	int calls, index;
+
+	allocator.allocate = &countAllocate;
+	allocator.reallocate = &countReallocate;
+	allocator.deallocate = &countDeallocate;
+	allocator.ptr = &counter;
+	wmemset(chunk, L'x', 1000);
+
+	parser = QxJsonParser_newWithAllocator(&allocator);
+	expect_not_null(parser);
+	expect_zero(QxJsonParser_setBufferCapacity(parser, 1024));
+	expect_zero(QxJsonParser_feed(parser, L"[\"", 2));
+	calls = counter.calls;
+
+	/* A 2 millions characters string grows the buffer geometrically */
+	for (index = 0; index < 2000; ++index)
+		expect_zero(QxJsonParser_feed(parser, chunk, 1000));
+
+	expect_ok(counter.calls - calls < 20);
+	expect_not_zero(QxJsonParser_setBufferCapacity(parser, 0));
+	expect_zero(QxJsonParser_feed(parser, L"\"]", 2));
+	expect_zero(QxJsonParser_end(parser, &root));
+	expect_int_equal(QxJsonValue_size(QxJsonValue_arrayGet(root, 0)), 2000000);
+	QxJsonValue_release(root);
+
+	/* Kept while successive documents use it */
+	calls = counter.calls;
+	expect_zero(QxJsonParser_feed(parser, L"\"", 1));
+
+	for (index = 0; index < 1000; ++index)
+		expect_zero(QxJsonParser_feed(parser, chunk, 1000));
+
+	expect_zero(QxJsonParser_feed(parser, L"\"", 1));
+	expect_zero(QxJsonParser_end(parser, &root));
+	QxJsonValue_release(root);
+	expect_ok(counter.calls - calls < 5);
+
+	/* Then shrunk back to its capacity after a small document */
+	expect_zero(QxJsonParser_feed(parser, L"[\"small\"]", 9));
+	expect_zero(QxJsonParser_end(parser, &root));
+	QxJsonValue_release(root);
+	expect_int_equal(counter.last, 1024 * sizeof(wchar_t));
+	calls = counter.calls;
+	expect_zero(QxJsonParser_setBufferCapacity(parser, 0));
+	expect_int_equal(counter.calls, calls);
+	expect_int_equal(counter.blocks, 3); /* Parser and both nesting stacks */
+
+	QxJsonParser_release(parser);
+	expect_zero(counter.blocks);
+}
+
+static void testSlowPath(void)
+{
+	QxJsonAllocator allocator, toggle;
+	QxJsonParser *parser;
+	QxJsonValue *root = NULL, *number;
+	wchar_t text[100];
+	size_t size;
+
+	allocator.allocate = &failAllocate;
+	allocator.reallocate = &failReallocate;
+	allocator.deallocate = &failDeallocate;
+	allocator.ptr = NULL;
+	toggle.allocate = &toggleAllocate;
+	toggle.reallocate = &toggleReallocate;
+	toggle.deallocate = &failDeallocate;
+	toggle.ptr = NULL;
+
+	/* A halfway number too long for the stack buffer of the slow path */
+	size = (size_t)swprintf(text, 100, L"[9007199254740993.%060d1]", 0);
+
+	/* The buffer comes from the allocator of the parser */
+	parser = QxJsonParser_newWithAllocator(&toggle);
+	expect_not_null(parser);
+	failing = 1;
+	expect_not_zero(QxJsonParser_feed(parser, text, size));
+	failing = 0;
+	QxJsonParser_release(parser);
+
+	parser = QxJsonParser_newWithAllocator(&toggle);
+	expect_not_null(parser);
+	QxJson_setAllocator(&allocator);
+	expect_zero(QxJsonParser_feed(parser, text, size));
+	expect_zero(QxJsonParser_end(parser, &root));
+	QxJson_setAllocator(NULL);
+	expect_double_equal(QxJsonValue_numberValue(QxJsonValue_arrayGet(root, 0)),
+		9007199254740994.0);
+	QxJsonValue_release(root);
+	QxJsonParser_release(parser);
+
+	/* A lazy number is decoded once memory is available */
+	parser = QxJsonParser_newWithAllocator(&toggle);
+	expect_not_null(parser);
+	expect_zero(QxJsonParser_setFlags(parser, QX_JSON_PARSER_LAZY_NUMBERS));
+	expect_zero(QxJsonParser_feed(parser, text, size));
+	expect_zero(QxJsonParser_end(parser, &root));
+	QxJsonParser_release(parser);
+
+	number = (QxJsonValue *)QxJsonValue_arrayGet(root, 0);
+	failing = 1;
+	expect_ok(QxJsonValue_numberValue(number) != QxJsonValue_numberValue(number));
+	failing = 0;
+	QxJson_setAllocator(&allocator);
+	expect_double_equal(QxJsonValue_numberValue(number), 9007199254740994.0);
+	QxJson_setAllocator(NULL);
+	QxJsonValue_release(root);
+}
+
+int main(void)
+{
+	testParser(0);
+	testParser(QX_JSON_PARSER_ARENA);
+	testDefault();
+	testLiterals();
+	testTokenBuffer();
+	testSlowPath();
+	return EXIT_SUCCESS;
+}
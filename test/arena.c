@@ -0,0 +1,168 @@
+/**
+ * @file arena.c
+ * @brief Testing source file of the arena allocation of parsed documents.
+ * @author Romain DEOUX
+ */
+
+#include <stdlib.h>
+#include <wchar.h>
+
+#include <qx.json.allocator.h>
+#include <qx.json.parser.h>
+#include <qx.json.value.h>
+
+#include "expect.h"
+
+static int failing = 0;
+
+static void *failAllocate(void *ptr, size_t size)
+{
+	(void)ptr;
+	return malloc(size);
+}
+
+/* Fails on demand */
+static void *failReallocate(void *ptr, void *block, size_t size)
+{
+	(void)ptr;
+	return failing ? NULL : realloc(block, size);
+}
+
+static void failDeallocate(void *ptr, void *block)
+{
+	(void)ptr;
+	free(block);
+}
+
+static QxJsonAllocator const failer = {
+	&failAllocate, &failReallocate, &failDeallocate, NULL
+};
+
+static QxJsonValue *parse(wchar_t const *text)
+{
+	QxJsonParser *parser;
+	QxJsonValue *root = NULL;
+
+	parser = QxJsonParser_new();
+	expect_not_null(parser);
+	expect_zero(QxJsonParser_setFlags(parser, QX_JSON_PARSER_ARENA));
+	expect_zero(QxJsonParser_feed(parser, text, wcslen(text)));
+	expect_zero(QxJsonParser_end(parser, &root));
+	QxJsonParser_release(parser);
+
+	expect_not_null(root);
+	return root;
+}
+
+static void testDocument(void)
+{
+	QxJsonValue *root, *items, *value, *key;
+	size_t index;
+
+	root = parse(L"{\"name\": \"arena\", \"items\": [1, true, null, [], {}],"
+		L" \"nested\": {\"key\": \"value\"}}");
+	expect_ok(QX_JSON_IS_OBJECT(root));
+	expect_int_equal(QxJsonValue_size(root), 3);
+
+	items = NULL;
+	expect_zero(QxJsonValue_objectGetData(root, L"items", 5, &items));
+	expect_ok(QX_JSON_IS_ARRAY(items));
+	expect_int_equal(QxJsonValue_size(items), 5);
+	expect_double_equal(QxJsonValue_numberValue(QxJsonValue_arrayGet(items, 0)), 1);
+
+	/* Arena containers keep growing */
+	for (index = 0; index < 100; ++index)
+		expect_zero(QxJsonValue_arrayAppendNew(items, QxJsonValue_numberNew(index)));
+
+	expect_int_equal(QxJsonValue_size(items), 105);
+	expect_double_equal(QxJsonValue_numberValue(QxJsonValue_arrayGet(items, 104)), 99);
+
+	/* Heap values stored in arena containers are released with the root */
+	key = QxJsonValue_stringNew(L"name", 4);
+	value = QxJsonValue_stringNew(L"heap", 4);
+	expect_zero(QxJsonValue_objectSet(root, key, value));
+	QxJsonValue_release(key);
+	QxJsonValue_release(value);
+
+	value = NULL;
+	expect_zero(QxJsonValue_objectGetData(root, L"name", 4, &value));
+	expect_wstr_equal(QxJsonValue_stringValue(value), L"heap");
+
+	key = QxJsonValue_stringNew(L"nested", 6);
+	expect_zero(QxJsonValue_objectUnset(root, key));
+	QxJsonValue_release(key);
+	expect_int_equal(QxJsonValue_size(root), 2);
+
+	/* Still alive after one release */
+	QxJsonValue_retains(root);
+	QxJsonValue_release(root);
+	expect_int_equal(QxJsonValue_size(root), 2);
+	QxJsonValue_release(root);
+}
+
+static void testAdoptFailure(void)
+{
+	QxJsonParser *parser;
+	QxJsonValue *root = NULL, *key, *value;
+	wchar_t name[2] = L"a";
+	size_t index;
+
+	parser = QxJsonParser_newWithAllocator(&failer);
+	expect_not_null(parser);
+	expect_zero(QxJsonParser_setFlags(parser, QX_JSON_PARSER_ARENA));
+	expect_zero(QxJsonParser_feed(parser, L"{}", 2));
+	expect_zero(QxJsonParser_end(parser, &root));
+	QxJsonParser_release(parser);
+
+	/* A single heap value, then pairs of them: one room is left */
+	for (index = 0; index < 4; ++index)
+	{
+		key = QxJsonValue_stringNew(name, 1);
+		value = index ? QxJsonValue_stringNew(L"heap", 4) : QxJsonValue_numberNewInt64(1);
+		expect_zero(QxJsonValue_objectSet(root, key, value));
+		QxJsonValue_release(key);
+		QxJsonValue_release(value);
+		++name[0];
+	}
+
+	/* The key is not kept when the value cannot be */
+	key = QxJsonValue_stringNew(name, 1);
+	value = QxJsonValue_stringNew(L"heap", 4);
+	failing = 1;
+	expect_not_zero(QxJsonValue_objectSet(root, key, value));
+	failing = 0;
+	expect_int_equal(QxJsonValue_size(root), 4);
+	expect_wstr_equal(QxJsonValue_stringValue(key), name);
+	QxJsonValue_release(key);
+	QxJsonValue_release(value);
+	QxJsonValue_release(root);
+}
+
+static void testScalar(void)
+{
+	QxJsonValue *root = parse(L"\"scalar\"");
+
+	expect_wstr_equal(QxJsonValue_stringValue(root), L"scalar");
+	QxJsonValue_release(root);
+}
+
+static void testUnfinished(void)
+{
+	QxJsonParser *parser;
+	wchar_t const *text = L"[{\"key\": [\"value\"";
+
+	parser = QxJsonParser_new();
+	expect_not_null(parser);
+	expect_zero(QxJsonParser_setFlags(parser, QX_JSON_PARSER_ARENA));
+	expect_zero(QxJsonParser_feed(parser, text, wcslen(text)));
+	QxJsonParser_release(parser);
+}
+
+int main(void)
+{
+	testDocument();
+	testAdoptFailure();
+	testScalar();
+	testUnfinished();
+	return EXIT_SUCCESS;
+}
@@ -14,6 +14,7 @@
 int main(void)
 {
 	QxJsonValue *array;
+	size_t index;
 
 	array = QxJsonValue_arrayNew();
 	expect_not_null(array);
@@ -47,6 +48,24 @@ int main(void)
 	expect_ok(QX_JSON_IS_TRUE(QxJsonValue_arrayGet(array, 3)));
 	/* T F N T */
 
+	QxJsonValue_release(array);
+
+	/* Growth of the storage */
+	array = QxJsonValue_arrayNew();
+	expect_not_null(array);
+
+	for (index = 0; index < 1000; ++index)
+		expect_zero(QxJsonValue_arrayAppendNew(array, QxJsonValue_numberNew(index)));
+
+	expect_zero(QxJsonValue_arrayInsertNew(array, 500, QxJsonValue_nullNew()));
+	expect_int_equal(QxJsonValue_size(array), 1001);
+	expect_double_equal(QxJsonValue_numberValue(QxJsonValue_arrayGet(array, 0)), 0);
+	expect_double_equal(QxJsonValue_numberValue(QxJsonValue_arrayGet(array, 499)), 499);
+	expect_ok(QX_JSON_IS_NULL(QxJsonValue_arrayGet(array, 500)));
+	expect_double_equal(QxJsonValue_numberValue(QxJsonValue_arrayGet(array, 501)), 500);
+	expect_double_equal(QxJsonValue_numberValue(QxJsonValue_arrayGet(array, 1000)), 999);
+	expect_null(QxJsonValue_arrayGet(array, 1001));
+
 	QxJsonValue_release(array);
 	return EXIT_SUCCESS;
 }
@@ -0,0 +1,266 @@
+/**
+ * @file buffer.c
+ * @brief Testing source file of the whole buffer parsing.
+ * @author Romain DEOUX
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+
+#include <qx.json.parser.h>
+#include <qx.json.value.h>
+
+#include "expect.h"
+
+static int equalValues(QxJsonValue const *first, QxJsonValue const *last);
+
+static int equalMember(QxJsonValue const *key, QxJsonValue *value, void *ptr)
+{
+	QxJsonValue *other;
+
+	if (QxJsonValue_objectGet((QxJsonValue *)ptr, key, &other) != 0)
+		return 1;
+
+	return !equalValues(value, other);
+}
+
+static int equalValues(QxJsonValue const *first, QxJsonValue const *last)
+{
+	double firstNumber, lastNumber;
+	size_t index;
+
+	if (QxJsonValue_type(first) != QxJsonValue_type(last)
+		|| QxJsonValue_size(first) != QxJsonValue_size(last))
+		return 0;
+
+	switch (QxJsonValue_type(first))
+	{
+	case QxJsonValueTypeNumber:
+		firstNumber = QxJsonValue_numberValue(first);
+		lastNumber = QxJsonValue_numberValue(last);
+		return memcmp(&firstNumber, &lastNumber, sizeof(double)) == 0
+			&& QxJsonValue_numberIsInteger(first) == QxJsonValue_numberIsInteger(last);
+
+	case QxJsonValueTypeString:
+		return wmemcmp(QxJsonValue_stringValue(first), QxJsonValue_stringValue(last),
+			QxJsonValue_size(first)) == 0;
+
+	case QxJsonValueTypeArray:
+		for (index = 0; index < QxJsonValue_size(first); ++index)
+		{
+			if (!equalValues(QxJsonValue_arrayGet(first, index),
+					QxJsonValue_arrayGet(last, index)))
+				return 0;
+		}
+
+		return 1;
+
+	case QxJsonValueTypeObject:
+		return QxJsonValue_objectEach((QxJsonValue *)first, &equalMember,
+			(void *)last) == 0;
+
+	default:
+		return 1;
+	}
+}
+
+/* Both engines must agree */
+static void check(char const *text, size_t size, int valid)
+{
+	QxJsonParser *parser;
+	QxJsonValue *streamed = NULL, *buffered = NULL;
+	int streamError, bufferError;
+
+	parser = QxJsonParser_new();
+	expect_not_null(parser);
+	streamError = QxJsonParser_feedUtf8(parser, text, size);
+
+	if (!streamError)
+		streamError = QxJsonParser_end(parser, &streamed);
+
+	QxJsonParser_release(parser);
+	bufferError = QxJson_parseBuffer(text, size, 0, &buffered);
+
+	__expect(__FILE__, __LINE__, !streamError == !bufferError,
+		"engines disagree (%d, %d) on %.*s", streamError, bufferError, (int)size, text);
+
+	if (valid >= 0)
+		__expect(__FILE__, __LINE__, (bufferError == 0) == valid,
+			"unexpected result %d on %.*s", bufferError, (int)size, text);
+
+	if (!streamError && !bufferError)
+	{
+		__expect(__FILE__, __LINE__, equalValues(streamed, buffered),
+			"different values for %.*s", (int)size, text);
+		QxJsonValue_release(streamed);
+		QxJsonValue_release(buffered);
+	}
+}
+
+static void testDocuments(void)
+{
+	char const *const valid[] = {
+		"0", "-12.5e-3", " true ", "false", "null", "\"\"", "[]", "{}", " [ ] ",
+		"[1,2,3]", "{\"a\":1,\"b\":[true,false,null],\"c\":{\"d\":\"e\"}}",
+		"[[[[[[[[[[]]]]]]]]]]", "[{}, {\"\": []}, [{}]]",
+		"\"esc \\\" \\\\ \\/ \\b \\f \\n \\r \\t \\u00e9 \\u20AC\"",
+		"\"\\\\\\\\\\\"\"", "\"caf\xc3\xa9 \xe2\x82\xac \xf0\x9f\x98\x80\"",
+		"[9223372036854775807, -9223372036854775808, 18446744073709551615]",
+		"[18446744073709551616, 1e308, 2.2250738585072014e-308, -0]",
+		"{\"a\" : 1 , \"a\" : 2}", "\t\r\n[\t1\r,\n2 ]\n"
+	};
+	char const *const invalid[] = {
+		"", " ", "[", "]", "{", "}", "[1,]", "[,1]", "{\"a\"}", "{\"a\":}",
+		"{\"a\" 1}", "{1:2}", "[1 2]", "tru", "truex", "nul", "[true false]",
+		"01", "1.", ".1", "-", "1e", "1e+", "+1", "\"abc", "\"\\x\"", "\"\\u12G4\"",
+		"\"a\tb\"", "\"\xc3\"", "\"\xed\xa0\x80\"", "\"\xc0\xaf\"", "[1]]", "[1]x",
+		"\"a\"\"b\"", "\"a\"1", "1 2", "{\"a\":1,}", "[\"a\\\"]", "\\", "\xc3\xa9"
+	};
+	size_t index;
+
+	for (index = 0; index < sizeof(valid) / sizeof(valid[0]); ++index)
+		check(valid[index], strlen(valid[index]), 1);
+
+	for (index = 0; index < sizeof(invalid) / sizeof(invalid[0]); ++index)
+		check(invalid[index], strlen(invalid[index]), 0);
+
+	/* Embedded nul characters */
+	check("\"a\0b\"", 5, 0);
+	check("[1]\0", 4, 0);
+}
+
+/* Random documents crossing the 64 bytes blocks in every way */
+static size_t randomValue(char *text, size_t size, int depth)
+{
+	static char const *const pieces[] = {
+		" ", "\\t", "\\\\", "\\\"", "\\u0041", "x", "\xc3\xa9", "\\n", "{", "]", ","
+	};
+	size_t length = 0, count, index;
+
+	switch (rand() % (depth < 6 ? 8 : 5))
+	{
+	case 0:
+		return (size_t)sprintf(text, "%d", rand() - RAND_MAX / 2);
+
+	case 1:
+		return (size_t)sprintf(text, "%d.%de%d", rand() % 1000, rand(), rand() % 40 - 20);
+
+	case 2:
+		return (size_t)sprintf(text, "%s", rand() % 2 ? "true" : "null");
+
+	case 3:
+	case 4:
+		text[length++] = '"';
+		count = (size_t)(rand() % 40);
+
+		for (index = 0; index < count && length + 8 < size; ++index)
+			length += (size_t)sprintf(text + length, "%s",
+				pieces[rand() % (sizeof(pieces) / sizeof(pieces[0]))]);
+
+		text[length++] = '"';
+		return length;
+
+	case 5:
+	case 6:
+		text[length++] = '[';
+		count = (size_t)(rand() % 6);
+
+		for (index = 0; index < count && length + 512 < size; ++index)
+		{
+			if (index)
+				text[length++] = ',';
+
+			length += (size_t)sprintf(text + length, "%*s", rand() % 70, "");
+			length += randomValue(text + length, size - length, depth + 1);
+		}
+
+		text[length++] = ']';
+		return length;
+
+	default:
+		text[length++] = '{';
+		count = (size_t)(rand() % 6);
+
+		for (index = 0; index < count && length + 512 < size; ++index)
+		{
+			if (index)
+				text[length++] = ',';
+
+			length += (size_t)sprintf(text + length, "\"k%d\\\\\" :%*s",
+				rand() % 5, rand() % 3, "");
+			length += randomValue(text + length, size - length, depth + 1);
+		}
+
+		text[length++] = '}';
+		return length;
+	}
+}
+
+static void testRandom(void)
+{
+	char text[65536];
+	size_t size;
+	int round;
+
+	srand(42);
+
+	for (round = 0; round < 2000; ++round)
+	{
+		size = randomValue(text, sizeof(text), 0);
+		check(text, size, 1);
+
+		/* Most likely broken */
+		text[(size_t)rand() % size] = "\"\\[]{}:, x0"[rand() % 11];
+		check(text, size, -1);
+	}
+}
+
+static void testFlags(void)
+{
+	char const *text = "{\"a\": [1.50, \"two\", {\"b\": null}], \"c\": 3}";
+	QxJsonValue *value = NULL, *member = NULL;
+
+	expect_zero(QxJson_parseBuffer(text, strlen(text),
+		QX_JSON_PARSER_ARENA | QX_JSON_PARSER_LAZY_NUMBERS, &value));
+	expect_ok(QX_JSON_IS_OBJECT(value));
+	expect_zero(QxJsonValue_objectGetUtf8(value, "a", 1, &member));
+	expect_wstr_equal(QxJsonValue_numberText(QxJsonValue_arrayGet(member, 0), NULL),
+		L"1.50");
+	QxJsonValue_release(value);
+
+	/* Arena with a scalar root */
+	expect_zero(QxJson_parseBuffer("42", 2, QX_JSON_PARSER_ARENA, &value));
+	expect_double_equal(QxJsonValue_numberValue(value), 42);
+	QxJsonValue_release(value);
+
+	/* Nothing leaks on errors */
+	expect_not_zero(QxJson_parseBuffer(text, strlen(text) - 1, QX_JSON_PARSER_ARENA,
+		&value));
+	expect_not_zero(QxJson_parseBuffer(NULL, 0, 0, &value));
+}
+
+static void testMaxDepth(void)
+{
+	char text[2 * QX_JSON_MAX_DEPTH + 2];
+	QxJsonValue *value = NULL;
+
+	memset(text, '[', QX_JSON_MAX_DEPTH + 1);
+	memset(text + QX_JSON_MAX_DEPTH + 1, ']', QX_JSON_MAX_DEPTH + 1);
+
+	expect_zero(QxJson_parseBuffer(text + 1, 2 * QX_JSON_MAX_DEPTH, 0, &value));
+	QxJsonValue_release(value);
+
+	/* One container too many, even empty */
+	expect_not_zero(QxJson_parseBuffer(text, sizeof(text), 0, &value));
+}
+
+int main(void)
+{
+	testDocuments();
+	testRandom();
+	testFlags();
+	testMaxDepth();
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,333 @@
+/**
+ * @file handler.c
+ * @brief Testing source file of the parsing events.
+ * @author Romain DEOUX
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+
+#include <qx.json.allocator.h>
+#include <qx.json.parser.h>
+
+#include "expect.h"
+
+/* Events are logged as a compact string */
+typedef struct Log
+{
+	char data[256];
+	size_t size;
+	int abortAt; /* Abort on this event, or -1 */
+	int events;
+
+	/* Skipping */
+	QxJsonParser *parser;
+	wchar_t skipKey;  /* Skip members whose key starts with it */
+	int skipObjects;  /* Skip nested objects */
+	int depth;
+} Log;
+
+static int logEvent(void *ptr, char event)
+{
+	Log *const log = (Log *)ptr;
+
+	expect_ok(log->size + 1 < sizeof(log->data));
+	log->data[log->size] = event;
+	++log->size;
+	log->data[log->size] = '\0';
+
+	if (log->events++ == log->abortAt)
+		return 42;
+
+	return 0;
+}
+
+static int onBeginArray(void *ptr)
+{
+	return logEvent(ptr, '[');
+}
+
+static int onEndArray(void *ptr)
+{
+	return logEvent(ptr, ']');
+}
+
+static int onBeginObject(void *ptr)
+{
+	Log *const log = (Log *)ptr;
+
+	if (log->skipObjects && log->depth++ > 0)
+		expect_zero(QxJsonParser_skip(log->parser));
+
+	return logEvent(ptr, '{');
+}
+
+static int onEndObject(void *ptr)
+{
+	Log *const log = (Log *)ptr;
+
+	if (log->skipObjects)
+		--log->depth;
+
+	return logEvent(ptr, '}');
+}
+
+static int onKey(void *ptr, wchar_t const *data, size_t size)
+{
+	Log *const log = (Log *)ptr;
+
+	expect_not_null(data);
+	expect_int_equal(wcslen(data), size);
+
+	if (log->skipKey && data[0] == log->skipKey)
+		expect_zero(QxJsonParser_skip(log->parser));
+
+	return logEvent(ptr, 'k');
+}
+
+static int onString(void *ptr, wchar_t const *data, size_t size)
+{
+	expect_not_null(data);
+	expect_int_equal(wcslen(data), size);
+	return logEvent(ptr, 's');
+}
+
+static int onNumber(void *ptr, double value)
+{
+	(void)value;
+	return logEvent(ptr, 'n');
+}
+
+static int onBoolean(void *ptr, int value)
+{
+	return logEvent(ptr, value ? 't' : 'f');
+}
+
+static int onNull(void *ptr)
+{
+	return logEvent(ptr, '0');
+}
+
+static QxJsonHandler const handler = {
+	&onBeginArray, &onEndArray,
+	&onBeginObject, &onEndObject,
+	&onKey, &onString, &onNumber, &onBoolean, &onNull,
+	NULL, NULL
+};
+
+/* Allocation counting */
+
+static int liveBlocks = 0;
+
+static void *countAllocate(void *ptr, size_t size)
+{
+	(void)ptr;
+	++liveBlocks;
+	return malloc(size);
+}
+
+static void *countReallocate(void *ptr, void *block, size_t size)
+{
+	(void)ptr;
+
+	if (!block)
+		++liveBlocks;
+
+	return realloc(block, size);
+}
+
+static void countDeallocate(void *ptr, void *block)
+{
+	(void)ptr;
+	--liveBlocks;
+	free(block);
+}
+
+static void testEvents(void)
+{
+	wchar_t const *text = L"{\"a\": [1, \"\", null, {}], \"b\": [[true, false]], \"c\": {\"d\": \"e\"}}";
+	QxJsonParser *parser;
+	Log log;
+
+	memset(&log, 0, sizeof(Log));
+	log.abortAt = -1;
+
+	parser = QxJsonParser_new();
+	expect_not_null(parser);
+	expect_zero(QxJsonParser_setHandler(parser, &handler, &log));
+	expect_zero(QxJsonParser_feed(parser, text, wcslen(text)));
+	expect_zero(QxJsonParser_end(parser, NULL));
+	expect_str_equal(log.data, "{k[ns0{}]k[[tf]]k{ks}}");
+
+	/* Scalar root value */
+	log.size = 0;
+	expect_zero(QxJsonParser_feed(parser, L"12", 2));
+	expect_zero(QxJsonParser_end(parser, NULL));
+	expect_str_equal(log.data, "n");
+
+	/* Incomplete document */
+	log.size = 0;
+	expect_zero(QxJsonParser_feed(parser, L"[1", 2));
+	expect_not_zero(QxJsonParser_end(parser, NULL));
+	QxJsonParser_release(parser);
+}
+
+static void testAbort(void)
+{
+	wchar_t const *text = L"[1, 2, 3]";
+	QxJsonParser *parser;
+	Log log;
+
+	memset(&log, 0, sizeof(Log));
+	log.abortAt = 2;
+
+	parser = QxJsonParser_new();
+	expect_not_null(parser);
+	expect_zero(QxJsonParser_setHandler(parser, &handler, &log));
+	expect_int_equal(QxJsonParser_feed(parser, text, wcslen(text)), 42);
+	expect_str_equal(log.data, "[nn");
+
+	/* The handler cannot be changed while parsing */
+	expect_not_zero(QxJsonParser_setHandler(parser, NULL, NULL));
+	QxJsonParser_release(parser);
+}
+
+static void parseSkipping(Log *log, wchar_t const *text, char const *events)
+{
+	QxJsonParser *parser;
+	size_t index;
+
+	/* Whole text */
+	parser = QxJsonParser_new();
+	expect_not_null(parser);
+	log->parser = parser;
+	log->size = 0;
+	log->depth = 0;
+	expect_zero(QxJsonParser_setHandler(parser, &handler, log));
+	expect_zero(QxJsonParser_feed(parser, text, wcslen(text)));
+	expect_zero(QxJsonParser_end(parser, NULL));
+	expect_str_equal(log->data, events);
+
+	/* Character by character */
+	log->size = 0;
+	log->depth = 0;
+
+	for (index = 0; text[index]; ++index)
+		expect_zero(QxJsonParser_feed(parser, text + index, 1));
+
+	expect_zero(QxJsonParser_end(parser, NULL));
+	expect_str_equal(log->data, events);
+	QxJsonParser_release(parser);
+}
+
+static void testSkip(void)
+{
+	Log log;
+
+	memset(&log, 0, sizeof(Log));
+	log.abortAt = -1;
+	log.skipKey = L's';
+
+	/* Member values */
+	parseSkipping(&log, L"{\"s1\": 12, \"a\": 1, \"s2\": \"x\\\"]}\", "
+		L"\"s3\":[\"\\\\\", {\"c\": \"}\"}, [[]]], \"s4\":true}", "{kknkkk}");
+	parseSkipping(&log, L"[{\"s\": {\"a\": [1, 2]}}, {\"s\":null }]", "[{k}{k}]");
+
+	/* Nested objects */
+	log.skipKey = 0;
+	log.skipObjects = 1;
+	parseSkipping(&log, L"{\"a\": {\"b\": [1, {}], \"c\": \"{\"}, \"d\": [{\"e\": 1}, 2]}",
+		"{k{}k[{}n]}");
+
+	/* Unbalanced skipped values */
+	log.skipObjects = 0;
+	log.skipKey = L's';
+	log.parser = QxJsonParser_new();
+	expect_zero(QxJsonParser_setHandler(log.parser, &handler, &log));
+	expect_not_zero(QxJsonParser_feed(log.parser, L"{\"s\": ]}", 8));
+	QxJsonParser_release(log.parser);
+
+	log.parser = QxJsonParser_new();
+	expect_zero(QxJsonParser_setHandler(log.parser, &handler, &log));
+	expect_not_zero(QxJsonParser_feed(log.parser, L"{\"s\": }", 7));
+	QxJsonParser_release(log.parser);
+
+	/* Not from a callback */
+	log.parser = QxJsonParser_new();
+	expect_not_zero(QxJsonParser_skip(log.parser));
+	QxJsonParser_release(log.parser);
+}
+
+static void testNoAllocation(void)
+{
+	wchar_t const *item = L"{\"key\": [1, 2.5, \"three\", null, true]},";
+	QxJsonAllocator allocator;
+	QxJsonParser *parser;
+	int blocks, i;
+	Log log;
+
+	allocator.allocate = &countAllocate;
+	allocator.reallocate = &countReallocate;
+	allocator.deallocate = &countDeallocate;
+	allocator.ptr = NULL;
+	memset(&log, 0, sizeof(Log));
+	log.abortAt = -1;
+
+	parser = QxJsonParser_newWithAllocator(&allocator);
+	expect_not_null(parser);
+	expect_zero(QxJsonParser_setHandler(parser, &handler, &log));
+	expect_zero(QxJsonParser_feed(parser, L"[", 1));
+	expect_zero(QxJsonParser_feed(parser, item, wcslen(item)));
+
+	/* The buffers are ready: no more allocations per value */
+	blocks = liveBlocks;
+
+	for (i = 0; i < 100; ++i)
+	{
+		log.size = 0;
+		expect_zero(QxJsonParser_feed(parser, item, wcslen(item)));
+		expect_int_equal(liveBlocks, blocks);
+	}
+
+	expect_zero(QxJsonParser_feed(parser, L"0]", 2));
+	expect_zero(QxJsonParser_end(parser, NULL));
+	expect_int_equal(liveBlocks, blocks);
+
+	QxJsonParser_release(parser);
+	expect_zero(liveBlocks);
+}
+
+static void testDocument(void)
+{
+	QxJsonParser *parser;
+	QxJsonValue *value = NULL;
+	Log log;
+
+	memset(&log, 0, sizeof(Log));
+	log.abortAt = -1;
+
+	/* Restoring the document building */
+	parser = QxJsonParser_new();
+	expect_not_null(parser);
+	expect_zero(QxJsonParser_setHandler(parser, &handler, &log));
+	expect_zero(QxJsonParser_setHandler(parser, NULL, NULL));
+	expect_zero(QxJsonParser_feed(parser, L"[true]", 6));
+	expect_not_zero(QxJsonParser_end(parser, NULL));
+	expect_zero(QxJsonParser_end(parser, &value));
+	expect_not_null(value);
+	expect_ok(QX_JSON_IS_ARRAY(value));
+	expect_zero(log.size);
+	QxJsonValue_release(value);
+	QxJsonParser_release(parser);
+}
+
+int main(void)
+{
+	testEvents();
+	testAbort();
+	testSkip();
+	testNoAllocation();
+	testDocument();
+	return EXIT_SUCCESS;
+}
@@ -16,5 +16,12 @@ int main(void)
 	expect_not_null(value);
 	expect_ok(QX_JSON_IS_NULL(value));
 	QxJsonValue_release(value);
+
+	/* A shared immortal instance */
+	expect_ok(QxJsonValue_nullNew() == value);
+	QxJsonValue_retains(value);
+	QxJsonValue_release(value);
+	QxJsonValue_release(value);
+	expect_ok(QX_JSON_IS_NULL(value));
 	return EXIT_SUCCESS;
 }
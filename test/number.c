@@ -4,6 +4,7 @@
  * @author Romain DEOUX
  */
 
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -18,6 +19,104 @@ static int compareNumbers(double first, double last)
 	return memcmp(&first, &last, sizeof(double));
 }
 
+static void testIntegers(void)
+{
+	QxJsonValue *number;
+	int64_t integer;
+	uint64_t unsignedInteger;
+
+	/* Beyond 2^53 */
+	number = QxJsonValue_numberNewInt64(INT64_C(9007199254740993));
+	expect_ok(QX_JSON_IS_NUMBER(number));
+	expect_ok(QxJsonValue_numberIsInteger(number));
+	expect_zero(QxJsonValue_numberInt64(number, &integer));
+	expect_ok(integer == INT64_C(9007199254740993));
+	expect_zero(QxJsonValue_numberUint64(number, &unsignedInteger));
+	expect_ok(unsignedInteger == UINT64_C(9007199254740993));
+	expect_double_equal(QxJsonValue_numberValue(number), 9007199254740992.);
+	QxJsonValue_release(number);
+
+	number = QxJsonValue_numberNewInt64(INT64_MIN);
+	expect_zero(QxJsonValue_numberInt64(number, &integer));
+	expect_ok(integer == INT64_MIN);
+	expect_not_zero(QxJsonValue_numberUint64(number, &unsignedInteger));
+	QxJsonValue_release(number);
+
+	number = QxJsonValue_numberNewUint64(UINT64_MAX);
+	expect_zero(QxJsonValue_numberUint64(number, &unsignedInteger));
+	expect_ok(unsignedInteger == UINT64_MAX);
+	expect_not_zero(QxJsonValue_numberInt64(number, &integer));
+	QxJsonValue_release(number);
+
+	/* Integral doubles */
+	number = QxJsonValue_numberNew(-42.);
+	expect_zero(QxJsonValue_numberIsInteger(number));
+	expect_zero(QxJsonValue_numberInt64(number, &integer));
+	expect_ok(integer == -42);
+	expect_not_zero(QxJsonValue_numberUint64(number, &unsignedInteger));
+	QxJsonValue_release(number);
+
+	number = QxJsonValue_numberNew(0.5);
+	expect_not_zero(QxJsonValue_numberInt64(number, &integer));
+	expect_not_zero(QxJsonValue_numberUint64(number, &unsignedInteger));
+	QxJsonValue_release(number);
+
+	/* Not exact from 2^53 on */
+	number = QxJsonValue_numberNew(9007199254740992.);
+	expect_not_zero(QxJsonValue_numberInt64(number, &integer));
+	expect_not_zero(QxJsonValue_numberUint64(number, &unsignedInteger));
+	QxJsonValue_release(number);
+
+	number = QxJsonValue_numberNew(-9223372036854775808.);
+	expect_not_zero(QxJsonValue_numberInt64(number, &integer));
+	QxJsonValue_release(number);
+
+	number = QxJsonValue_numberNew(1e300);
+	expect_not_zero(QxJsonValue_numberInt64(number, &integer));
+	expect_not_zero(QxJsonValue_numberUint64(number, &unsignedInteger));
+	QxJsonValue_release(number);
+}
+
+static void testSmallIntegers(void)
+{
+	int64_t const integers[] = {
+		0, -1, 42, -42,
+		(int64_t)(INTPTR_MAX / 2), (int64_t)(INTPTR_MAX / 2) + 1,
+		(int64_t)(INTPTR_MIN / 2), (int64_t)(INTPTR_MIN / 2) - 1
+	};
+	QxJsonValue *number, *other;
+	int64_t integer;
+	uint64_t unsignedInteger;
+	size_t index;
+
+	/* Same behaviour on both sides of the immediate range */
+	for (index = 0; index != ARRAY_SIZE(integers); ++index)
+	{
+		number = QxJsonValue_numberNewInt64(integers[index]);
+		expect_not_null(number);
+		expect_ok(QX_JSON_IS_NUMBER(number));
+		expect_zero(QxJsonValue_size(number));
+		expect_ok(QxJsonValue_numberIsInteger(number));
+		expect_zero(QxJsonValue_numberInt64(number, &integer));
+		expect_ok(integer == integers[index]);
+		expect_int_equal(QxJsonValue_numberUint64(number, &unsignedInteger) == 0,
+			integers[index] >= 0);
+		expect_double_equal(QxJsonValue_numberValue(number), (double)integers[index]);
+		expect_null(QxJsonValue_numberText(number, NULL));
+		QxJsonValue_retains(number);
+		QxJsonValue_release(number);
+		QxJsonValue_release(number);
+	}
+
+	/* Not a container */
+	number = QxJsonValue_numberNewInt64(3);
+	other = QxJsonValue_numberNewInt64(4);
+	expect_not_zero(QxJsonValue_arrayAppendNew(number, other));
+	expect_null(QxJsonValue_arrayGet(number, 0));
+	expect_not_zero(QxJsonValue_objectGetData(number, L"a", 1, &other));
+	expect_null(QxJsonValue_stringValue(number));
+}
+
 int main(void)
 {
 	QxJsonValue *number;
@@ -42,5 +141,7 @@ int main(void)
 	expect_not_zero(compareNumbers(QxJsonValue_numberValue(number), 0.));
 	QxJsonValue_release(number);
 
+	testIntegers();
+	testSmallIntegers();
 	return EXIT_SUCCESS;
 }
@@ -5,13 +5,118 @@
  */
 
 #include <stdlib.h>
+#include <wchar.h>
 
 #include <qx.json.value.h>
 
 #include "expect.h"
 
+static int checkOrder(QxJsonValue const *key, QxJsonValue *value, void *ptr)
+{
+	double *expected = (double *)ptr;
+
+	(void)key;
+	expect_double_equal(QxJsonValue_numberValue(value), *expected);
+	*expected += 2;
+	return 0;
+}
+
+static void testManyKeys(void)
+{
+	QxJsonValue *object, *key, *value;
+	wchar_t buffer[16];
+	double expected = 1;
+	int index;
+
+	object = QxJsonValue_objectNew();
+	expect_not_null(object);
+
+	for (index = 0; index < 1000; ++index)
+	{
+		key = QxJsonValue_stringNew(buffer, swprintf(buffer, 16, L"key%d", index));
+		value = QxJsonValue_numberNew(index);
+		expect_zero(QxJsonValue_objectSet(object, key, value));
+		QxJsonValue_release(key);
+		QxJsonValue_release(value);
+	}
+
+	expect_int_equal(QxJsonValue_size(object), 1000);
+
+	/* Remove the even keys */
+	for (index = 0; index < 1000; index += 2)
+	{
+		key = QxJsonValue_stringNew(buffer, swprintf(buffer, 16, L"key%d", index));
+		expect_zero(QxJsonValue_objectUnset(object, key));
+		QxJsonValue_release(key);
+	}
+
+	expect_int_equal(QxJsonValue_size(object), 500);
+
+	/* Grow again after the removals */
+	for (index = 1000; index < 1600; ++index)
+	{
+		key = QxJsonValue_stringNew(buffer, swprintf(buffer, 16, L"key%d", index));
+		value = QxJsonValue_nullNew();
+		expect_zero(QxJsonValue_objectSet(object, key, value));
+		QxJsonValue_release(key);
+		QxJsonValue_release(value);
+	}
+
+	for (index = 0; index < 1600; ++index)
+	{
+		key = QxJsonValue_stringNew(buffer, swprintf(buffer, 16, L"key%d", index));
+		value = NULL;
+
+		if (index < 1000 && index % 2 == 0)
+		{
+			expect_not_zero(QxJsonValue_objectGet(object, key, &value));
+			expect_null(value);
+		}
+		else
+		{
+			expect_zero(QxJsonValue_objectGet(object, key, &value));
+			expect_not_null(value);
+		}
+
+		QxJsonValue_release(key);
+	}
+
+	/* Keys are walked in insertion order */
+	for (index = 1000; index < 1600; ++index)
+	{
+		key = QxJsonValue_stringNew(buffer, swprintf(buffer, 16, L"key%d", index));
+		expect_zero(QxJsonValue_objectUnset(object, key));
+		QxJsonValue_release(key);
+	}
+
+	expect_zero(QxJsonValue_objectEach(object, &checkOrder, &expected));
+	expect_double_equal(expected, 1001);
+	QxJsonValue_release(object);
+}
+
+static void testUtf8Keys(void)
+{
+	QxJsonValue *object, *key, *value;
+
+	object = QxJsonValue_objectNew();
+	key = QxJsonValue_stringNew(L"\u00E9t\u00E9 \U0001D11E", 5);
+	value = QxJsonValue_nullNew();
+	expect_zero(QxJsonValue_objectSet(object, key, value));
+	QxJsonValue_release(key);
+	QxJsonValue_release(value);
+
+	value = NULL;
+	expect_zero(QxJsonValue_objectGetUtf8(object,
+		"\xC3\xA9t\xC3\xA9 \xF0\x9D\x84\x9E", 10, &value));
+	expect_ok(QX_JSON_IS_NULL(value));
+	expect_not_zero(QxJsonValue_objectGetUtf8(object,
+		"\xC3\xA9t\xC3\xA9 ", 6, &value));
+	QxJsonValue_release(object);
+}
+
 int main(void)
 {
+	static QxJsonKey key1Handle = QX_JSON_KEY(L"key1");
 	QxJsonValue *object, *value;
 	QxJsonValue *key0, *value0;
 	QxJsonValue *key1, *value1;
@@ -46,6 +151,21 @@ int main(void)
 	expect_ok(QX_JSON_IS_STRING(value));
 	expect_wstr_equal(QxJsonValue_stringValue(value), L"value1");
 
+	/* get value 1 without a key value */
+	value = NULL;
+	expect_zero(QxJsonValue_objectGetData(object, L"key1", 4, &value));
+	expect_wstr_equal(QxJsonValue_stringValue(value), L"value1");
+	value = NULL;
+	expect_zero(QxJsonValue_objectGetUtf8(object, "key1", 4, &value));
+	expect_wstr_equal(QxJsonValue_stringValue(value), L"value1");
+	value = NULL;
+	expect_zero(QxJsonValue_objectGetKey(object, &key1Handle, &value));
+	expect_wstr_equal(QxJsonValue_stringValue(value), L"value1");
+	expect_not_zero(QxJsonValue_objectGetData(object, L"key", 3, &value));
+	expect_null(value);
+	expect_not_zero(QxJsonValue_objectGetUtf8(object, "key1\xFF", 5, &value));
+	expect_null(value);
+
 	/* unset key 0 */
 	expect_zero(QxJsonValue_objectUnset(object, key0));
 	expect_int_equal(QxJsonValue_size(object), 1);
@@ -63,5 +183,8 @@ int main(void)
 	QxJsonValue_release(key1);
 	QxJsonValue_release(value1);
 	QxJsonValue_release(object);
+
+	testManyKeys();
+	testUtf8Keys();
 	return EXIT_SUCCESS;
 }
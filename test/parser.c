@@ -4,7 +4,11 @@
  * @author Romain DEOUX
  */
 
+#include <float.h>
+#include <locale.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <wchar.h>
 
 #include <qx.json.parser.h>
@@ -62,6 +66,50 @@ static void testNestedArray(void)
 	QxJsonValue_release(root);
 }
 
+static void testMaxDepth(void)
+{
+	wchar_t text[2 * QX_JSON_MAX_DEPTH + 2];
+	QxJsonParser *parser;
+	QxJsonValue *root = NULL;
+	size_t index;
+
+	for (index = 0; index <= QX_JSON_MAX_DEPTH; ++index)
+	{
+		text[index] = L'[';
+		text[QX_JSON_MAX_DEPTH + 1 + index] = L']';
+	}
+
+	parser = QxJsonParser_new();
+	expect_not_null(parser);
+
+	/* Up to the default limit */
+	expect_zero(QxJsonParser_feed(parser, text + 1, 2 * QX_JSON_MAX_DEPTH));
+	expect_zero(QxJsonParser_end(parser, &root));
+	expect_not_null(root);
+	QxJsonValue_release(root);
+
+	/* One container too many */
+	expect_not_zero(QxJsonParser_feed(parser, text, QX_JSON_MAX_DEPTH + 1));
+	QxJsonParser_reset(parser);
+
+	/* Custom limits */
+	expect_zero(QxJsonParser_setMaxDepth(parser, 2));
+	expect_zero(QxJsonParser_feed(parser, L"[{\"a\": 1}, [], {}]", 18));
+	expect_zero(QxJsonParser_end(parser, &root));
+	QxJsonValue_release(root);
+	expect_not_zero(QxJsonParser_feed(parser, L"[[[", 3));
+	expect_not_zero(QxJsonParser_setMaxDepth(parser, 0));
+	QxJsonParser_reset(parser);
+
+	expect_zero(QxJsonParser_setMaxDepth(parser, 0));
+	expect_zero(QxJsonParser_feed(parser, text, 2 * QX_JSON_MAX_DEPTH + 2));
+	expect_zero(QxJsonParser_end(parser, &root));
+	QxJsonValue_release(root);
+
+	expect_not_zero(QxJsonParser_setMaxDepth(NULL, 0));
+	QxJsonParser_release(parser);
+}
+
 static void testFalse(void)
 {
 	QxJsonParser *parser;
@@ -114,9 +162,317 @@ static void testNumber(void)
 	expect_not_null(root);
 	expect_ok(QX_JSON_IS_NUMBER(root));
 	expect_double_equal(QxJsonValue_numberValue(root), 3.1415);
+	expect_null(QxJsonValue_numberText(root, NULL));
+	QxJsonValue_release(root);
+}
+
+/* Parse a number and compare it bitwise with strtod() */
+static void checkNumber(char const *text)
+{
+	QxJsonParser *parser;
+	QxJsonValue *root = NULL;
+	double expected, actual;
+
+	expected = strtod(text, NULL);
+	parser = QxJsonParser_new();
+	expect_not_null(parser);
+	expect_zero(QxJsonParser_feedUtf8(parser, text, strlen(text)));
+	expect_zero(QxJsonParser_end(parser, &root));
+	QxJsonParser_release(parser);
+
+	expect_not_null(root);
+	actual = QxJsonValue_numberValue(root);
+	__expect(__FILE__, __LINE__, memcmp(&actual, &expected, sizeof(double)) == 0,
+		"%s decoded as %.17g instead of %.17g", text, actual, expected);
+	QxJsonValue_release(root);
+}
+
+/* Parse an integer and compare it exactly */
+static void checkInteger(char const *text, int isInteger)
+{
+	QxJsonParser *parser;
+	QxJsonValue *root = NULL;
+	int64_t integer;
+	uint64_t unsignedInteger;
+
+	parser = QxJsonParser_new();
+	expect_not_null(parser);
+	expect_zero(QxJsonParser_feedUtf8(parser, text, strlen(text)));
+	expect_zero(QxJsonParser_end(parser, &root));
+	QxJsonParser_release(parser);
+
+	expect_not_null(root);
+	__expect(__FILE__, __LINE__, QxJsonValue_numberIsInteger(root) == isInteger,
+		"%s integer state", text);
+
+	if (!isInteger)
+	{
+		/* Kept as a double, not exact from 2^53 on */
+		if (QxJsonValue_numberValue(root) >= 9007199254740992.0
+			|| QxJsonValue_numberValue(root) <= -9007199254740992.0)
+		{
+			__expect(__FILE__, __LINE__,
+				QxJsonValue_numberInt64(root, &integer) != 0
+					&& QxJsonValue_numberUint64(root, &unsignedInteger) != 0,
+				"%s converted to an integer", text);
+		}
+	}
+	else if (text[0] == '-')
+	{
+		expect_zero(QxJsonValue_numberInt64(root, &integer));
+		__expect(__FILE__, __LINE__, integer == strtoll(text, NULL, 10),
+			"%s decoded as %lld", text, (long long)integer);
+	}
+	else
+	{
+		expect_zero(QxJsonValue_numberUint64(root, &unsignedInteger));
+		__expect(__FILE__, __LINE__, unsignedInteger == strtoull(text, NULL, 10),
+			"%s decoded as %llu", text, (unsigned long long)unsignedInteger);
+	}
+
+	QxJsonValue_release(root);
+}
+
+static void testIntegers(void)
+{
+	checkInteger("0", 1);
+	checkInteger("-1", 1);
+	checkInteger("9007199254740993", 1);
+	checkInteger("-9007199254740993", 1);
+	checkInteger("9223372036854775807", 1);
+	checkInteger("9223372036854775808", 1);
+	checkInteger("-9223372036854775808", 1);
+	checkInteger("18446744073709551615", 1);
+	checkInteger("12345678901234567890", 1);
+
+	/* Doubles */
+	checkInteger("-0", 0);
+	checkInteger("18446744073709551616", 0);
+	checkInteger("-9223372036854775809", 0);
+	checkInteger("100000000000000000000000", 0);
+	checkInteger("1.0", 0);
+	checkInteger("1e2", 0);
+	checkInteger("9007199254740993.0", 0);
+	checkInteger("-9007199254740993e0", 0);
+	checkNumber("18446744073709551616");
+	checkNumber("-9223372036854775809");
+	checkNumber("9007199254740993");
+}
+
+static void testLazyNumbers(unsigned int flags)
+{
+	wchar_t const *text = L"[1.50, -7, 3.14159265358979323846264338327950288, 1e400, 2]";
+	QxJsonParser *parser;
+	QxJsonValue *root = NULL;
+	QxJsonValue const *item;
+	int64_t integer;
+	size_t size = 0;
+
+	parser = QxJsonParser_new();
+	expect_not_null(parser);
+	expect_zero(QxJsonParser_setFlags(parser, flags));
+	expect_zero(QxJsonParser_feed(parser, text, wcslen(text)));
+	expect_zero(QxJsonParser_end(parser, &root));
+	QxJsonParser_release(parser);
+	expect_not_null(root);
+
+	/* The source text is kept as is */
+	item = QxJsonValue_arrayGet(root, 0);
+	expect_wstr_equal(QxJsonValue_numberText(item, &size), L"1.50");
+	expect_int_equal(size, 4);
+	expect_zero(QxJsonValue_size(item));
+	expect_double_equal(QxJsonValue_numberValue(item), 1.5);
+	expect_wstr_equal(QxJsonValue_numberText(item, NULL), L"1.50");
+	expect_double_equal(QxJsonValue_numberValue(item), 1.5);
+	expect_zero(QxJsonValue_numberIsInteger(item));
+
+	item = QxJsonValue_arrayGet(root, 1);
+	expect_zero(QxJsonValue_numberInt64(item, &integer));
+	expect_ok(integer == -7);
+	expect_ok(QxJsonValue_numberIsInteger(item));
+
+	item = QxJsonValue_arrayGet(root, 2);
+	expect_wstr_equal(QxJsonValue_numberText(item, NULL),
+		L"3.14159265358979323846264338327950288");
+	expect_double_equal(QxJsonValue_numberValue(item), 3.14159265358979323846);
+
+	/* Out of range numbers are accepted */
+	item = QxJsonValue_arrayGet(root, 3);
+	expect_ok(QxJsonValue_numberValue(item) > DBL_MAX);
+
+	/* Never decoded */
+	item = QxJsonValue_arrayGet(root, 4);
+	expect_wstr_equal(QxJsonValue_numberText(item, NULL), L"2");
 	QxJsonValue_release(root);
 }
 
+static void testNumberDecoding(void)
+{
+	char const *const numbers[] = {
+		"0", "-0", "0.0", "-0.0e5", "1", "-1", "42", "0.1", "0.3", "1e23",
+		"9007199254740992", "9007199254740993", "9007199254740995",
+		"18446744073709551615", "18446744073709551616",
+		"123456789012345678901234567890", "0.000001234567890123456789012",
+		"1.7976931348623157e308", "1.7976931348623158e308",
+		"2.2250738585072011e-308", "2.2250738585072014e-308",
+		"4.9406564584124654e-324", "2.4703282292062327e-324",
+		"2.4703282292062328e-324", "1e-400", "7.8459735791271921e65",
+		"3.0540412e5", "1E+2", "1e-2", "5e-324", "0.1e-999999",
+		"1" "00000000000000000000000000000000000000000000000000" "e-50",
+		"9007199254740993.000000000000000000000000000000001",
+		"2.4703282292062327208828439643411068618252990130716238221279284125033775363510437593264991818081799618989828234772285886546332835517796989819938739800539093906315035659515570226392290858392449105184435931802849936536152500319370457678249219365623669863658480757001585769269903706311928279558551332927834338409351978015531246597263579574622766465e-324"
+	};
+	char text[64];
+	size_t index;
+	unsigned long seed = 12345, bits[2];
+	double value;
+
+	for (index = 0; index != sizeof(numbers) / sizeof(numbers[0]); ++index)
+		checkNumber(numbers[index]);
+
+	for (index = 0; index != 4000; ++index)
+	{
+		seed = (seed * 1103515245 + 12345) & 0xFFFFFFFF;
+		bits[0] = seed;
+		seed = (seed * 1103515245 + 12345) & 0xFFFFFFFF;
+		bits[1] = seed;
+
+		/* Random decimal numbers */
+		sprintf(text, "%lu.%lue%d", bits[0], bits[1], (int)(bits[0] % 600) - 330);
+		checkNumber(text);
+
+		/* Round trip of random doubles */
+		value = (double)bits[0] * (double)bits[1];
+		value = index % 2 ? value * 1e-300 * (double)(bits[0] % 1000) : value;
+		sprintf(text, "%.17g", value);
+		checkNumber(text);
+	}
+}
+
+static void testNumberLocale(void)
+{
+	char const *const locales[] = { "de_DE.UTF-8", "fr_FR.UTF-8", "de_DE", "fr_FR" };
+	QxJsonParser *parser;
+	QxJsonValue *root = NULL;
+	size_t index;
+
+	/* The slow path must not depend on the decimal point of the locale */
+	for (index = 0; index != sizeof(locales) / sizeof(locales[0]); ++index)
+	{
+		if (!setlocale(LC_NUMERIC, locales[index]))
+			continue;
+
+		parser = QxJsonParser_new();
+		expect_not_null(parser);
+		expect_zero(QxJsonParser_feed(parser,
+			L"[1.5, 9007199254740993.0000000000000000000001]", 47));
+		expect_zero(QxJsonParser_end(parser, &root));
+		QxJsonParser_release(parser);
+		setlocale(LC_NUMERIC, "C");
+
+		expect_double_equal(QxJsonValue_numberValue(QxJsonValue_arrayGet(root, 0)), 1.5);
+		expect_double_equal(QxJsonValue_numberValue(QxJsonValue_arrayGet(root, 1)),
+			9007199254740994.0);
+		QxJsonValue_release(root);
+		break;
+	}
+}
+
+static int firstKey(QxJsonValue const *key, QxJsonValue *value, void *ptr)
+{
+	(void)value;
+	*(QxJsonValue const **)ptr = key;
+	return 1;
+}
+
+static void checkSharedKeys(QxJsonValue *root)
+{
+	QxJsonValue const *keys[4];
+	size_t index;
+
+	expect_not_null(root);
+
+	for (index = 0; index != 4; ++index)
+		expect_int_equal(QxJsonValue_objectEach(
+			(QxJsonValue *)QxJsonValue_arrayGet(root, index), &firstKey,
+			keys + index), 1);
+
+	/* Short keys are shared, not the long ones */
+	expect_ok(keys[0] == keys[1]);
+	expect_ok(keys[2] != keys[3]);
+	expect_wstr_equal(QxJsonValue_stringValue(keys[3]),
+		L"a key too long to be worth sharing");
+	QxJsonValue_release(root);
+}
+
+static void testSharedKeys(unsigned int flags)
+{
+	char const *text = "[{\"id\": 1}, {\"id\": 2},"
+		" {\"a key too long to be worth sharing\": 3},"
+		" {\"a key too long to be worth sharing\": 4}]";
+	QxJsonParser *parser;
+	QxJsonValue *root = NULL;
+
+	parser = QxJsonParser_new();
+	expect_not_null(parser);
+	expect_zero(QxJsonParser_setFlags(parser, flags));
+	expect_zero(QxJsonParser_feedUtf8(parser, text, strlen(text)));
+	expect_zero(QxJsonParser_end(parser, &root));
+	checkSharedKeys(root);
+
+	/* Dropped along with an unfinished document */
+	expect_zero(QxJsonParser_feedUtf8(parser, text, 20));
+	QxJsonParser_release(parser);
+
+	root = NULL;
+	expect_zero(QxJson_parseBuffer(text, strlen(text), flags, &root));
+	checkSharedKeys(root);
+}
+
+static void checkUtf8Strings(QxJsonValue *root)
+{
+	QxJsonValue *list = NULL;
+	QxJsonValue const *item;
+	size_t size = 0;
+
+	expect_not_null(root);
+	expect_zero(QxJsonValue_objectGetUtf8(root, "cl\xc3\xa9", 4, &list));
+	expect_zero(QxJsonValue_objectGetData(root, L"cl\u00e9", 3, &list));
+
+	item = QxJsonValue_arrayGet(list, 0);
+	expect_str_equal(QxJsonValue_stringUtf8(item, &size), "h\xc3\xa9 \"");
+	expect_int_equal(size, 5);
+	expect_int_equal(QxJsonValue_size(item), 4);
+	expect_wstr_equal(QxJsonValue_stringValue(item), L"h\u00e9 \"");
+
+	/* Lone surrogates stay wide */
+	item = QxJsonValue_arrayGet(list, 1);
+	expect_null(QxJsonValue_stringUtf8(item, NULL));
+	expect_int_equal(QxJsonValue_stringValue(item)[0], 0xD800);
+
+	QxJsonValue_release(root);
+}
+
+static void testUtf8Strings(unsigned int flags)
+{
+	char const *text = "{\"cl\xc3\xa9\": [\"h\\u00e9 \\\"\", \"\\ud800\"]}";
+	QxJsonParser *parser;
+	QxJsonValue *root = NULL;
+
+	flags |= QX_JSON_PARSER_UTF8_STRINGS;
+	parser = QxJsonParser_new();
+	expect_not_null(parser);
+	expect_zero(QxJsonParser_setFlags(parser, flags));
+	expect_zero(QxJsonParser_feedUtf8(parser, text, strlen(text)));
+	expect_zero(QxJsonParser_end(parser, &root));
+	QxJsonParser_release(parser);
+	checkUtf8Strings(root);
+
+	root = NULL;
+	expect_zero(QxJson_parseBuffer(text, strlen(text), flags, &root));
+	checkUtf8Strings(root);
+}
+
 static void testObject(void)
 {
 	QxJsonParser *parser;
@@ -157,6 +513,218 @@ static void testString(void)
 	QxJsonValue_release(root);
 }
 
+/* Parse a string fed by chunks, wide or UTF-8 */
+static void checkString(char const *text, size_t chunk, wchar_t const *expected)
+{
+	QxJsonParser *parser;
+	QxJsonValue *root = NULL;
+	wchar_t wide[2048];
+	size_t size = strlen(text), index, length;
+
+	expect_ok(size < sizeof(wide) / sizeof(wchar_t));
+
+	for (index = 0; index <= size; ++index)
+		wide[index] = (wchar_t)(unsigned char)text[index];
+
+	/* Wide */
+	parser = QxJsonParser_new();
+	expect_not_null(parser);
+
+	for (index = 0; index < size; index += length)
+	{
+		length = size - index < chunk ? size - index : chunk;
+		expect_zero(QxJsonParser_feed(parser, wide + index, length));
+	}
+
+	expect_zero(QxJsonParser_end(parser, &root));
+	expect_ok(QX_JSON_IS_STRING(root));
+	expect_wstr_equal(QxJsonValue_stringValue(root), expected);
+	QxJsonValue_release(root);
+
+	/* UTF-8 */
+	for (index = 0; index < size; index += length)
+	{
+		length = size - index < chunk ? size - index : chunk;
+		expect_zero(QxJsonParser_feedUtf8(parser, text + index, length));
+	}
+
+	expect_zero(QxJsonParser_end(parser, &root));
+	expect_ok(QX_JSON_IS_STRING(root));
+	expect_wstr_equal(QxJsonValue_stringValue(root), expected);
+	QxJsonValue_release(root);
+	QxJsonParser_release(parser);
+}
+
+static void testStringScanning(void)
+{
+	QxJsonParser *parser;
+	char text[1500];
+	wchar_t expected[1500];
+	size_t index;
+
+	/* Runs longer than the token buffer steps */
+	text[0] = '"';
+
+	for (index = 0; index < 1400; ++index)
+	{
+		text[index + 1] = (char)('a' + index % 26);
+		expected[index] = (wchar_t)('a' + index % 26);
+	}
+
+	text[1401] = '"';
+	text[1402] = '\0';
+	expected[1400] = L'\0';
+	checkString(text, 1500, expected);
+	checkString(text, 7, expected);
+	checkString(text, 1, expected);
+
+	/* Escapes between runs */
+	checkString("\"ab\\\"cd\\nef\\u00e9\\u20ACgh\"", 3, L"ab\"cd\nef\u00e9\u20ACgh");
+	checkString("\"ab\\\"cd\\nef\\u00e9\\u20ACgh\"", 64, L"ab\"cd\nef\u00e9\u20ACgh");
+
+	/* Unescaped control characters */
+	parser = QxJsonParser_new();
+	expect_not_null(parser);
+	expect_not_zero(QxJsonParser_feed(parser, L"\"a\nb\"", 5));
+	QxJsonParser_release(parser);
+
+	parser = QxJsonParser_new();
+	expect_not_null(parser);
+	expect_not_zero(QxJsonParser_feedUtf8(parser, "\"ab\t\"", 5));
+	QxJsonParser_release(parser);
+}
+
+/* A document indented with long runs of white spaces */
+static void testIndentation(void)
+{
+	QxJsonParser *parser;
+	QxJsonValue *root = NULL;
+	QxJsonValue const *item;
+	char letters[100];
+	char text[4096];
+	wchar_t wide[4096];
+	size_t size = 0, index, depth;
+
+	for (index = 0; index < sizeof(letters); ++index)
+		letters[index] = (char)('a' + index % 26);
+
+	text[size++] = '[';
+
+	for (index = 0; index < 20; ++index)
+	{
+		text[size++] = '\n';
+
+		for (depth = 0; depth < index * 3 + 1; ++depth)
+			text[size++] = depth % 5 ? ' ' : '\t';
+
+		size += (size_t)sprintf(text + size, "{\r\n%*s\"key\" :\t \"%.*s\"\n}%s",
+			(int)index * 4, "", (int)index * 5, letters, index < 19 ? "," : "");
+	}
+
+	text[size++] = ']';
+	text[size] = '\0';
+
+	for (index = 0; index <= size; ++index)
+		wide[index] = (wchar_t)text[index];
+
+	parser = QxJsonParser_new();
+	expect_not_null(parser);
+
+	/* Wide then UTF-8, whole and by chunks */
+	for (index = 0; index < 4; ++index)
+	{
+		if (index == 0)
+			expect_zero(QxJsonParser_feed(parser, wide, size));
+		else if (index == 1)
+			expect_zero(QxJsonParser_feedUtf8(parser, text, size));
+		else
+		{
+			for (depth = 0; depth < size; depth += 13)
+			{
+				if (index == 2)
+					expect_zero(QxJsonParser_feed(parser, wide + depth,
+						size - depth < 13 ? size - depth : 13));
+				else
+					expect_zero(QxJsonParser_feedUtf8(parser, text + depth,
+						size - depth < 13 ? size - depth : 13));
+			}
+		}
+
+		expect_zero(QxJsonParser_end(parser, &root));
+		expect_ok(QX_JSON_IS_ARRAY(root));
+		expect_int_equal(QxJsonValue_size(root), 20);
+		item = QxJsonValue_arrayGet(root, 19);
+		expect_ok(QX_JSON_IS_OBJECT(item));
+		expect_int_equal(QxJsonValue_size(item), 1);
+		QxJsonValue_release(root);
+	}
+
+	QxJsonParser_release(parser);
+}
+
+/* Every kind of token split between two feeds, at every position */
+static void testSplitTokens(void)
+{
+	char const *text = "[false,true,null,-0.5e+2,0,12,\"a\\u00e9\\n\",{\"k\":[]}]";
+	char const *invalid = "[nul,tru]";
+	wchar_t wide[64];
+	size_t const size = strlen(text);
+	size_t index, split;
+	QxJsonParser *parser;
+	QxJsonValue *root = NULL;
+	int error;
+
+	for (index = 0; index <= size; ++index)
+		wide[index] = (wchar_t)text[index];
+
+	parser = QxJsonParser_new();
+	expect_not_null(parser);
+
+	for (split = 0; split <= size; ++split)
+	{
+		for (index = 0; index < 2; ++index)
+		{
+			if (index == 0)
+			{
+				expect_zero(QxJsonParser_feed(parser, wide, split));
+				expect_zero(QxJsonParser_feed(parser, wide + split, size - split));
+			}
+			else
+			{
+				expect_zero(QxJsonParser_feedUtf8(parser, text, split));
+				expect_zero(QxJsonParser_feedUtf8(parser, text + split, size - split));
+			}
+
+			expect_zero(QxJsonParser_end(parser, &root));
+			expect_int_equal(QxJsonValue_size(root), 8);
+			expect_ok(QX_JSON_IS_FALSE(QxJsonValue_arrayGet(root, 0)));
+			expect_ok(QX_JSON_IS_NULL(QxJsonValue_arrayGet(root, 2)));
+			expect_double_equal(QxJsonValue_numberValue(QxJsonValue_arrayGet(root, 3)), -50);
+			expect_double_equal(QxJsonValue_numberValue(QxJsonValue_arrayGet(root, 5)), 12);
+			expect_wstr_equal(QxJsonValue_stringValue(QxJsonValue_arrayGet(root, 6)),
+				L"a\xe9\n");
+			QxJsonValue_release(root);
+		}
+	}
+
+	QxJsonParser_release(parser);
+
+	/* Truncated literals are rejected whatever the split */
+	for (split = 0; split <= strlen(invalid); ++split)
+	{
+		parser = QxJsonParser_new();
+		expect_not_null(parser);
+		error = QxJsonParser_feedUtf8(parser, invalid, split);
+
+		if (!error)
+			error = QxJsonParser_feedUtf8(parser, invalid + split,
+				strlen(invalid) - split);
+
+		expect_not_zero(error);
+		QxJsonParser_release(parser);
+	}
+}
+
 static void testTrue(void)
 {
 	QxJsonParser *parser;
@@ -218,16 +786,82 @@ static void testPartialTocken(void)
 	}
 }
 
+static void testUtf8(void)
+{
+	/* {"clé": "€ 𝄞"} */
+	char const text[] =
+		"{\"cl\xC3\xA9\": \"\xE2\x82\xAC \xF0\x9D\x84\x9E\"}";
+	char const *invalidCases[] = {
+		"\"\x80\"",             /* Unexpected continuation byte */
+		"\"\xC0\xAF\"",         /* Overlong encoding */
+		"\"\xED\xA0\x80\"",     /* Surrogate */
+		"\"\xF4\x90\x80\x80\"", /* Out of range */
+		"\"\xE2\x82\"",         /* Truncated sequence */
+	};
+	QxJsonParser *parser;
+	QxJsonValue *root = NULL;
+	QxJsonValue *key, *value = NULL;
+	size_t idx;
+
+	parser = QxJsonParser_new();
+	expect_not_null(parser);
+
+	/* Byte per byte to split every multi-byte sequence */
+	for (idx = 0; idx < sizeof(text) - 1; ++idx)
+		expect_zero(QxJsonParser_feedUtf8(parser, text + idx, 1));
+
+	expect_zero(QxJsonParser_end(parser, &root));
+	QxJsonParser_release(parser);
+
+	expect_not_null(root);
+	expect_ok(QX_JSON_IS_OBJECT(root));
+	key = QxJsonValue_stringNew(L"cl\u00E9", 3);
+	expect_zero(QxJsonValue_objectGet(root, key, &value));
+	QxJsonValue_release(key);
+	expect_not_null(value);
+	expect_wstr_equal(QxJsonValue_stringValue(value), L"\u20AC \U0001D11E");
+	QxJsonValue_release(root);
+
+	for (idx = 0; idx < sizeof(invalidCases) / sizeof(invalidCases[0]); ++idx)
+	{
+		char const *testCase = invalidCases[idx];
+
+		parser = QxJsonParser_new();
+		expect_not_null(parser);
+		root = NULL;
+		expect_not_zero(
+			QxJsonParser_feedUtf8(parser, testCase, strlen(testCase))
+			|| QxJsonParser_end(parser, &root));
+		expect_null(root);
+		QxJsonParser_release(parser);
+	}
+}
+
 int main(void)
 {
 	testArray();
 	testNestedArray();
+	testMaxDepth();
 	testFalse();
 	testNull();
 	testNumber();
+	testNumberDecoding();
+	testNumberLocale();
+	testIntegers();
+	testLazyNumbers(QX_JSON_PARSER_LAZY_NUMBERS);
+	testLazyNumbers(QX_JSON_PARSER_LAZY_NUMBERS | QX_JSON_PARSER_ARENA);
 	testObject();
+	testSharedKeys(0);
+	testSharedKeys(QX_JSON_PARSER_ARENA);
+	testSharedKeys(QX_JSON_PARSER_UTF8_STRINGS);
+	testUtf8Strings(0);
+	testUtf8Strings(QX_JSON_PARSER_ARENA);
 	testString();
+	testStringScanning();
+	testIndentation();
+	testSplitTokens();
 	testTrue();
 	testPartialTocken();
+	testUtf8();
 	return EXIT_SUCCESS;
 }
@@ -0,0 +1,309 @@
+/**
+ * @file pool.c
+ * @brief Testing source file of the parser reuse.
+ * @author Romain DEOUX
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <wchar.h>
+
+#include <qx.json.allocator.h>
+#include <qx.json.parser.h>
+
+#include "expect.h"
+
+static int liveBlocks = 0;
+static int calls = 0;
+
+static void *countAllocate(void *ptr, size_t size)
+{
+	(void)ptr;
+	++liveBlocks;
+	++calls;
+	return malloc(size);
+}
+
+static void *countReallocate(void *ptr, void *block, size_t size)
+{
+	(void)ptr;
+
+	if (!block)
+		++liveBlocks;
+
+	++calls;
+	return realloc(block, size);
+}
+
+static void countDeallocate(void *ptr, void *block)
+{
+	(void)ptr;
+	--liveBlocks;
+	free(block);
+}
+
+static QxJsonAllocator const counting = {
+	&countAllocate, &countReallocate, &countDeallocate, NULL
+};
+
+static int ignore(void *ptr)
+{
+	(void)ptr;
+	return 0;
+}
+
+static int ignoreString(void *ptr, wchar_t const *data, size_t size)
+{
+	(void)ptr;
+	(void)data;
+	(void)size;
+	return 0;
+}
+
+static int ignoreNumber(void *ptr, double value)
+{
+	(void)ptr;
+	(void)value;
+	return 0;
+}
+
+static int ignoreBoolean(void *ptr, int value)
+{
+	(void)ptr;
+	(void)value;
+	return 0;
+}
+
+static QxJsonHandler const handler = {
+	&ignore, &ignore, &ignore, &ignore,
+	&ignoreString, &ignoreString, &ignoreNumber, &ignoreBoolean, &ignore,
+	NULL, NULL
+};
+
+static void checkDocument(QxJsonParser *parser)
+{
+	QxJsonValue *root = NULL;
+
+	expect_zero(QxJsonParser_feed(parser, L"{\"a\": [1, true]}", 16));
+	expect_zero(QxJsonParser_end(parser, &root));
+	expect_not_null(root);
+	expect_ok(QX_JSON_IS_OBJECT(root));
+	QxJsonValue_release(root);
+}
+
+static void testReset(void)
+{
+	QxJsonParser *parser;
+
+	parser = QxJsonParser_new();
+	expect_not_null(parser);
+
+	/* Unfinished document */
+	expect_zero(QxJsonParser_feed(parser, L"[1, {\"a\": [\"b", 13));
+	QxJsonParser_reset(parser);
+	checkDocument(parser);
+
+	/* After an error */
+	expect_not_zero(QxJsonParser_feed(parser, L"[1, ]", 5));
+	QxJsonParser_reset(parser);
+	checkDocument(parser);
+
+	/* Truncated UTF-8 sequence, with an arena */
+	expect_zero(QxJsonParser_setFlags(parser, QX_JSON_PARSER_ARENA));
+	expect_zero(QxJsonParser_feedUtf8(parser, "[{\"\xc3", 4));
+	expect_not_zero(QxJsonParser_setFlags(parser, 0));
+	QxJsonParser_reset(parser);
+	checkDocument(parser);
+
+	/* Settings are kept */
+	expect_zero(QxJsonParser_setHandler(parser, &handler, NULL));
+	expect_zero(QxJsonParser_feed(parser, L"[", 1));
+	QxJsonParser_reset(parser);
+	expect_zero(QxJsonParser_feed(parser, L"[]", 2));
+	expect_zero(QxJsonParser_end(parser, NULL));
+
+	QxJsonParser_reset(NULL);
+	QxJsonParser_release(parser);
+}
+
+static void testBuffersKept(void)
+{
+	wchar_t const *text = L"[{\"key\": \"a long enough string value\"}, [[[-12.5e3]]]]";
+	QxJsonParser *parser;
+	int before;
+
+	parser = QxJsonParser_newWithAllocator(&counting);
+	expect_not_null(parser);
+	expect_zero(QxJsonParser_setHandler(parser, &handler, NULL));
+	expect_zero(QxJsonParser_feed(parser, text, wcslen(text)));
+	expect_zero(QxJsonParser_end(parser, NULL));
+
+	/* No more allocations for the next documents */
+	before = calls;
+	expect_zero(QxJsonParser_feed(parser, text, 20));
+	QxJsonParser_reset(parser);
+	expect_zero(QxJsonParser_feed(parser, text, wcslen(text)));
+	expect_zero(QxJsonParser_end(parser, NULL));
+	expect_int_equal(calls, before);
+
+	QxJsonParser_release(parser);
+	expect_zero(liveBlocks);
+}
+
+/* Allocations made to parse a document */
+static int countDocument(QxJsonParser *parser, wchar_t const *text, size_t size)
+{
+	QxJsonValue *root = NULL;
+	int const before = calls;
+
+	expect_zero(QxJsonParser_feed(parser, text, size));
+	expect_zero(QxJsonParser_end(parser, &root));
+	QxJsonValue_release(root);
+	return calls - before;
+}
+
+static void testStackKept(void)
+{
+	wchar_t text[65];
+	QxJsonParser *parser;
+	int first, second;
+	size_t index;
+
+	for (index = 0; index < 32; ++index)
+	{
+		text[index] = L'[';
+		text[33 + index] = L']';
+	}
+
+	text[32] = L'1';
+
+	parser = QxJsonParser_newWithAllocator(&counting);
+	expect_not_null(parser);
+
+	/* The stacks of containers only grow with the first document */
+	first = countDocument(parser, text, 65);
+	second = countDocument(parser, text, 65);
+	expect_ok(first > second);
+	expect_int_equal(countDocument(parser, text, 65), second);
+
+	QxJsonParser_release(parser);
+	expect_zero(liveBlocks);
+}
+
+static void testPool(void)
+{
+	QxJsonParser *first, *second;
+
+	first = QxJsonParser_acquire();
+	expect_not_null(first);
+	second = QxJsonParser_acquire();
+	expect_not_null(second);
+	expect_ok(first != second);
+
+	/* Given back with custom settings and an unfinished document */
+	expect_zero(QxJsonParser_setHandler(first, &handler, NULL));
+	expect_zero(QxJsonParser_feed(first, L"[1", 2));
+	QxJsonParser_recycle(first);
+	QxJsonParser_recycle(second);
+	QxJsonParser_recycle(NULL);
+
+	/* Last in, first out, with the default settings */
+	expect_ok(QxJsonParser_acquire() == second);
+	expect_ok(QxJsonParser_acquire() == first);
+	checkDocument(first);
+	QxJsonParser_release(first);
+	QxJsonParser_release(second);
+}
+
+static void testPoolDefaults(void)
+{
+	wchar_t chunk[1000];
+	QxJsonParser *parser;
+	int before, index;
+
+	/* A parser with another allocator is not pooled */
+	parser = QxJsonParser_newWithAllocator(&counting);
+	expect_not_null(parser);
+	QxJsonParser_recycle(parser);
+	expect_zero(liveBlocks);
+
+	/* The token buffer is shrunk back to the default capacity */
+	QxJson_setAllocator(&counting);
+	parser = QxJsonParser_acquire();
+	expect_not_null(parser);
+	expect_zero(QxJsonParser_setBufferCapacity(parser, 100000));
+	expect_zero(QxJsonParser_setHandler(parser, &handler, NULL));
+	wmemset(chunk, L'x', 1000);
+	expect_zero(QxJsonParser_feed(parser, L"\"", 1));
+
+	for (index = 0; index < 50; ++index)
+		expect_zero(QxJsonParser_feed(parser, chunk, 1000));
+
+	expect_zero(QxJsonParser_feed(parser, L"\"", 1));
+	expect_zero(QxJsonParser_end(parser, NULL));
+	before = calls;
+	QxJsonParser_recycle(parser);
+	expect_ok(calls > before);
+
+	expect_ok(QxJsonParser_acquire() == parser);
+	QxJsonParser_release(parser);
+	QxJson_setAllocator(NULL);
+	expect_zero(liveBlocks);
+
+	/* Parsers pooled before the default allocator changed are not reused */
+	QxJson_setAllocator(&counting);
+	parser = QxJsonParser_acquire();
+	expect_not_null(parser);
+	QxJsonParser_recycle(parser);
+	expect_ok(liveBlocks > 0);
+	QxJson_setAllocator(NULL);
+	parser = QxJsonParser_acquire();
+	expect_not_null(parser);
+	expect_zero(liveBlocks);
+	checkDocument(parser);
+	QxJsonParser_release(parser);
+}
+
+static void *poolThread(void *ptr)
+{
+	QxJsonParser *parsers[6];
+	size_t index;
+
+	(void)ptr;
+
+	/* More than the pool keeps */
+	for (index = 0; index < 6; ++index)
+	{
+		parsers[index] = QxJsonParser_acquire();
+		expect_not_null(parsers[index]);
+		checkDocument(parsers[index]);
+	}
+
+	for (index = 0; index < 6; ++index)
+		QxJsonParser_recycle(parsers[index]);
+
+	return NULL;
+}
+
+static void testThreadExit(void)
+{
+	pthread_t thread;
+
+	/* The pool of the thread is freed when it exits */
+	QxJson_setAllocator(&counting);
+	expect_zero(pthread_create(&thread, NULL, &poolThread, NULL));
+	expect_zero(pthread_join(thread, NULL));
+	QxJson_setAllocator(NULL);
+	expect_zero(liveBlocks);
+}
+
+int main(void)
+{
+	testReset();
+	testBuffersKept();
+	testStackKept();
+	testPool();
+	testPoolDefaults();
+	testThreadExit();
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,238 @@
+/**
+ * @file projection.c
+ * @brief Testing source file of the QxJsonProjection class.
+ * @author Romain DEOUX
+ */
+
+#include <stdlib.h>
+#include <wchar.h>
+
+#include <qx.json.parser.h>
+#include <qx.json.projection.h>
+#include <qx.json.value.h>
+
+#include "expect.h"
+
+static wchar_t const document[] =
+	L"{\"user\": {\"id\": 42, \"name\": \"Ada\", \"tags\": [\"a\", \"b\"]},"
+	L" \"items\": [{\"price\": 1.5, \"label\": \"x\"}, {\"label\": \"y\"},"
+	L" {\"price\": 3, \"extra\": {\"price\": 0}}],"
+	L" \"blob\": {\"deep\": [[[\"}\\\"\"]]]}, \"a/b\": 1, \"c~d\": [true]}";
+
+static QxJsonValue *parseText(wchar_t const *text,
+	QxJsonProjection const *projection, unsigned int flags)
+{
+	QxJsonParser *parser;
+	QxJsonValue *root = NULL;
+
+	parser = QxJsonParser_new();
+	expect_not_null(parser);
+	expect_zero(QxJsonParser_setFlags(parser, flags));
+	expect_zero(QxJsonParser_setProjection(parser, projection));
+	expect_zero(QxJsonParser_feed(parser, text, wcslen(text)));
+	expect_zero(QxJsonParser_end(parser, &root));
+	QxJsonParser_release(parser);
+	expect_not_null(root);
+	return root;
+}
+
+static QxJsonValue *parse(QxJsonProjection const *projection, unsigned int flags)
+{
+	return parseText(document, projection, flags);
+}
+
+static QxJsonValue *member(QxJsonValue *object, wchar_t const *key)
+{
+	QxJsonValue *value = NULL;
+
+	expect_ok(QX_JSON_IS_OBJECT(object));
+	expect_zero(QxJsonValue_objectGetData(object, key, wcslen(key), &value));
+	expect_not_null(value);
+	return value;
+}
+
+static void testPaths(unsigned int flags)
+{
+	QxJsonProjection *projection;
+	QxJsonValue *root, *user, *items, *item;
+
+	projection = QxJsonProjection_new();
+	expect_not_null(projection);
+	expect_zero(QxJsonProjection_add(projection, L"/user/id", 8));
+	expect_zero(QxJsonProjection_add(projection, L"/user/tags", 10));
+	expect_zero(QxJsonProjection_add(projection, L"/items/*/price", 14));
+	expect_zero(QxJsonProjection_add(projection, L"/a~1b", 5));
+
+	root = parse(projection, flags);
+	expect_int_equal(QxJsonValue_size(root), 3);
+
+	user = member(root, L"user");
+	expect_int_equal(QxJsonValue_size(user), 2);
+	expect_double_equal(QxJsonValue_numberValue(member(user, L"id")), 42);
+	expect_int_equal(QxJsonValue_size(member(user, L"tags")), 2);
+
+	/* Containers leading to the selected paths are kept */
+	items = member(root, L"items");
+	expect_int_equal(QxJsonValue_size(items), 3);
+	item = (QxJsonValue *)QxJsonValue_arrayGet(items, 0);
+	expect_int_equal(QxJsonValue_size(item), 1);
+	expect_double_equal(QxJsonValue_numberValue(member(item, L"price")), 1.5);
+	expect_zero(QxJsonValue_size(QxJsonValue_arrayGet(items, 1)));
+	item = (QxJsonValue *)QxJsonValue_arrayGet(items, 2);
+	expect_int_equal(QxJsonValue_size(item), 1);
+
+	expect_double_equal(QxJsonValue_numberValue(member(root, L"a/b")), 1);
+	QxJsonValue_release(root);
+	QxJsonProjection_release(projection);
+}
+
+static void testIndexes(void)
+{
+	QxJsonProjection *projection;
+	QxJsonValue *root, *items;
+
+	projection = QxJsonProjection_new();
+	expect_not_null(projection);
+	expect_zero(QxJsonProjection_add(projection, L"/items/2", 8));
+	expect_zero(QxJsonProjection_add(projection, L"/c~0d/0", 7));
+	expect_zero(QxJsonProjection_add(projection, L"/user/tags/1", 12));
+
+	root = parse(projection, 0);
+	expect_int_equal(QxJsonValue_size(root), 3);
+	items = member(root, L"items");
+	expect_int_equal(QxJsonValue_size(items), 1);
+	expect_int_equal(QxJsonValue_size(member((QxJsonValue *)QxJsonValue_arrayGet(items, 0), L"extra")), 1);
+	expect_ok(QX_JSON_IS_TRUE(QxJsonValue_arrayGet(member(root, L"c~d"), 0)));
+	expect_wstr_equal(QxJsonValue_stringValue(
+		QxJsonValue_arrayGet(member(member(root, L"user"), L"tags"), 0)), L"b");
+	QxJsonValue_release(root);
+	QxJsonProjection_release(projection);
+}
+
+static void testOverlap(void)
+{
+	QxJsonProjection *projection;
+	QxJsonValue *root, *user, *items, *item;
+
+	/* A named token added after the wildcard */
+	projection = QxJsonProjection_new();
+	expect_not_null(projection);
+	expect_zero(QxJsonProjection_add(projection, L"/items/*/price", 14));
+	expect_zero(QxJsonProjection_add(projection, L"/items/0/label", 14));
+
+	root = parse(projection, 0);
+	items = member(root, L"items");
+	expect_int_equal(QxJsonValue_size(items), 3);
+	item = (QxJsonValue *)QxJsonValue_arrayGet(items, 0);
+	expect_int_equal(QxJsonValue_size(item), 2);
+	expect_double_equal(QxJsonValue_numberValue(member(item, L"price")), 1.5);
+	expect_wstr_equal(QxJsonValue_stringValue(member(item, L"label")), L"x");
+	expect_zero(QxJsonValue_size(QxJsonValue_arrayGet(items, 1)));
+	expect_int_equal(QxJsonValue_size(QxJsonValue_arrayGet(items, 2)), 1);
+	QxJsonValue_release(root);
+	QxJsonProjection_release(projection);
+
+	/* Named tokens added before the wildcard */
+	projection = QxJsonProjection_new();
+	expect_not_null(projection);
+	expect_zero(QxJsonProjection_add(projection, L"/items/1/label", 14));
+	expect_zero(QxJsonProjection_add(projection, L"/user/tags/0", 12));
+	expect_zero(QxJsonProjection_add(projection, L"/items/*/price", 14));
+	expect_zero(QxJsonProjection_add(projection, L"/user/*", 7));
+
+	root = parse(projection, 0);
+	expect_int_equal(QxJsonValue_size(root), 2);
+	items = member(root, L"items");
+	expect_int_equal(QxJsonValue_size(QxJsonValue_arrayGet(items, 0)), 1);
+	item = (QxJsonValue *)QxJsonValue_arrayGet(items, 1);
+	expect_int_equal(QxJsonValue_size(item), 1);
+	expect_wstr_equal(QxJsonValue_stringValue(member(item, L"label")), L"y");
+	expect_int_equal(QxJsonValue_size(QxJsonValue_arrayGet(items, 2)), 1);
+
+	/* The wildcard selects the whole tags array */
+	user = member(root, L"user");
+	expect_int_equal(QxJsonValue_size(user), 3);
+	expect_int_equal(QxJsonValue_size(member(user, L"tags")), 2);
+	QxJsonValue_release(root);
+	QxJsonProjection_release(projection);
+}
+
+static void testMismatch(unsigned int flags)
+{
+	static wchar_t const text[] =
+		L"{\"user\": 5, \"items\": [{\"price\": 1}, 3, \"s\", [2], null],"
+		L" \"id\": {\"x\": 1}}";
+	QxJsonProjection *projection;
+	QxJsonValue *root, *items;
+
+	/* Scalars where the paths expect a container are dropped */
+	projection = QxJsonProjection_new();
+	expect_not_null(projection);
+	expect_zero(QxJsonProjection_add(projection, L"/user/id", 8));
+	expect_zero(QxJsonProjection_add(projection, L"/items/*/price", 14));
+	expect_zero(QxJsonProjection_add(projection, L"/id", 3));
+
+	root = parseText(text, projection, flags);
+	expect_int_equal(QxJsonValue_size(root), 2);
+	items = member(root, L"items");
+	expect_int_equal(QxJsonValue_size(items), 2);
+	expect_int_equal(QxJsonValue_size(QxJsonValue_arrayGet(items, 0)), 1);
+	expect_ok(QX_JSON_IS_ARRAY(QxJsonValue_arrayGet(items, 1)));
+	expect_zero(QxJsonValue_size(QxJsonValue_arrayGet(items, 1)));
+
+	/* A container where a leaf is expected is kept whole */
+	expect_int_equal(QxJsonValue_size(member(root, L"id")), 1);
+	QxJsonValue_release(root);
+
+	/* The root is always kept */
+	root = parseText(L"7", projection, flags);
+	expect_double_equal(QxJsonValue_numberValue(root), 7);
+	QxJsonValue_release(root);
+	QxJsonProjection_release(projection);
+}
+
+static void testWhole(void)
+{
+	QxJsonProjection *projection;
+	QxJsonValue *root;
+
+	/* No path: only the root remains */
+	projection = QxJsonProjection_new();
+	expect_not_null(projection);
+	root = parse(projection, 0);
+	expect_zero(QxJsonValue_size(root));
+	QxJsonValue_release(root);
+
+	/* The empty pointer selects everything */
+	expect_zero(QxJsonProjection_add(projection, L"", 0));
+	root = parse(projection, 0);
+	expect_int_equal(QxJsonValue_size(root), 5);
+	QxJsonValue_release(root);
+	QxJsonProjection_release(projection);
+}
+
+static void testMalformed(void)
+{
+	QxJsonProjection *projection;
+
+	projection = QxJsonProjection_new();
+	expect_not_null(projection);
+	expect_not_zero(QxJsonProjection_add(projection, L"user", 4));
+	expect_not_zero(QxJsonProjection_add(projection, L"/a~2", 4));
+	expect_not_zero(QxJsonProjection_add(projection, L"/a~", 3));
+	expect_not_zero(QxJsonProjection_add(NULL, L"/a", 2));
+	QxJsonProjection_release(projection);
+}
+
+int main(void)
+{
+	testPaths(0);
+	testPaths(QX_JSON_PARSER_ARENA);
+	testIndexes();
+	testOverlap();
+	testMismatch(0);
+	testMismatch(QX_JSON_PARSER_ARENA);
+	testWhole();
+	testMalformed();
+	return EXIT_SUCCESS;
+}
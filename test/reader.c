@@ -0,0 +1,249 @@
+/**
+ * @file reader.c
+ * @brief Testing source file of the QxJsonReader class.
+ * @author Romain DEOUX
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+
+#include <qx.json.allocator.h>
+#include <qx.json.reader.h>
+
+#include "expect.h"
+
+static void *strictAllocate(void *ptr, size_t size)
+{
+	(void)ptr;
+	return malloc(size);
+}
+
+static void *strictReallocate(void *ptr, void *block, size_t size)
+{
+	(void)ptr;
+	return realloc(block, size);
+}
+
+static void strictDeallocate(void *ptr, void *block)
+{
+	(void)ptr;
+	expect_not_null(block);
+	free(block);
+}
+
+static QxJsonAllocator const strict = {
+	&strictAllocate, &strictReallocate, &strictDeallocate, NULL
+};
+
+static void testEvents(void)
+{
+	wchar_t const *text = L"{\"a\": [1, \"two\", null], \"b\": {\"c\": true}, \"d\": false}";
+	QxJsonReader *reader;
+	wchar_t const *string;
+	size_t size = 0;
+
+	reader = QxJsonReader_new(text, wcslen(text));
+	expect_not_null(reader);
+	expect_int_equal(QxJsonReader_next(reader), QxJsonEventBeginObject);
+	expect_null(QxJsonReader_string(reader, &size));
+	expect_int_equal(QxJsonReader_next(reader), QxJsonEventKey);
+	string = QxJsonReader_string(reader, &size);
+	expect_int_equal(size, 1);
+	expect_wstr_equal(string, L"a");
+	expect_int_equal(QxJsonReader_next(reader), QxJsonEventBeginArray);
+	expect_int_equal(QxJsonReader_next(reader), QxJsonEventNumber);
+	expect_double_equal(QxJsonReader_number(reader), 1);
+	expect_int_equal(QxJsonReader_next(reader), QxJsonEventString);
+	expect_wstr_equal(QxJsonReader_string(reader, NULL), L"two");
+	expect_int_equal(QxJsonReader_next(reader), QxJsonEventNull);
+	expect_int_equal(QxJsonReader_next(reader), QxJsonEventEndArray);
+	expect_int_equal(QxJsonReader_next(reader), QxJsonEventKey);
+	expect_int_equal(QxJsonReader_next(reader), QxJsonEventBeginObject);
+	expect_int_equal(QxJsonReader_next(reader), QxJsonEventKey);
+	expect_int_equal(QxJsonReader_next(reader), QxJsonEventTrue);
+	expect_int_equal(QxJsonReader_next(reader), QxJsonEventEndObject);
+	expect_int_equal(QxJsonReader_next(reader), QxJsonEventKey);
+	expect_int_equal(QxJsonReader_next(reader), QxJsonEventFalse);
+	expect_int_equal(QxJsonReader_next(reader), QxJsonEventEndObject);
+	expect_int_equal(QxJsonReader_next(reader), QxJsonEventEnd);
+	expect_int_equal(QxJsonReader_next(reader), QxJsonEventEnd);
+	QxJsonReader_release(reader);
+}
+
+static void testRootNumber(void)
+{
+	QxJsonReader *reader;
+	int64_t integer;
+	uint64_t unsignedInteger;
+
+	reader = QxJsonReader_newUtf8("-2.5", 4);
+	expect_not_null(reader);
+	expect_int_equal(QxJsonReader_next(reader), QxJsonEventNumber);
+	expect_double_equal(QxJsonReader_number(reader), -2.5);
+	expect_not_zero(QxJsonReader_int64(reader, &integer));
+	expect_int_equal(QxJsonReader_next(reader), QxJsonEventEnd);
+	QxJsonReader_release(reader);
+
+	/* Exact integers */
+	reader = QxJsonReader_newUtf8("[-9223372036854775808, 18446744073709551615]", 44);
+	expect_not_null(reader);
+	expect_int_equal(QxJsonReader_next(reader), QxJsonEventBeginArray);
+	expect_int_equal(QxJsonReader_next(reader), QxJsonEventNumber);
+	expect_zero(QxJsonReader_int64(reader, &integer));
+	expect_ok(integer == INT64_MIN);
+	expect_not_zero(QxJsonReader_uint64(reader, &unsignedInteger));
+	expect_int_equal(QxJsonReader_next(reader), QxJsonEventNumber);
+	expect_zero(QxJsonReader_uint64(reader, &unsignedInteger));
+	expect_ok(unsignedInteger == UINT64_MAX);
+	expect_not_zero(QxJsonReader_int64(reader, &integer));
+	expect_double_equal(QxJsonReader_number(reader), 18446744073709551615.);
+	QxJsonReader_release(reader);
+}
+
+static void testSkip(void)
+{
+	char const *text = "{\"skipped\": {\"x\": [1, [2, {}]], \"y\": \"]\"}, \"id\": 7, \"tail\": [[]]}";
+	QxJsonReader *reader;
+	wchar_t const *key;
+	double id = 0;
+
+	reader = QxJsonReader_newUtf8(text, strlen(text));
+	expect_not_null(reader);
+	expect_int_equal(QxJsonReader_next(reader), QxJsonEventBeginObject);
+
+	/* Only read the "id" member, then stop */
+	while (QxJsonReader_next(reader) == QxJsonEventKey)
+	{
+		key = QxJsonReader_string(reader, NULL);
+
+		if (wcscmp(key, L"id") == 0)
+		{
+			expect_int_equal(QxJsonReader_next(reader), QxJsonEventNumber);
+			id = QxJsonReader_number(reader);
+			break;
+		}
+
+		expect_zero(QxJsonReader_skip(reader));
+	}
+
+	expect_double_equal(id, 7);
+
+	/* Skipping a container from its beginning */
+	expect_int_equal(QxJsonReader_next(reader), QxJsonEventKey);
+	expect_int_equal(QxJsonReader_next(reader), QxJsonEventBeginArray);
+	expect_zero(QxJsonReader_skip(reader));
+	expect_int_equal(QxJsonReader_next(reader), QxJsonEventEndObject);
+	QxJsonReader_release(reader);
+}
+
+static void testSlices(void)
+{
+	char *text = (char *)malloc(40000);
+	QxJsonReader *reader;
+	size_t size = 0, index;
+	wchar_t const *string;
+
+	/* Values spanning several slices of input */
+	size += (size_t)sprintf(text + size, "{\"skipped\": [");
+
+	for (index = 0; index < 1000; ++index)
+		size += (size_t)sprintf(text + size, "[1, {\"k\": \"\xC3\xA9\"}], ");
+
+	size += (size_t)sprintf(text + size, "0], \"s\": \"");
+
+	for (index = 0; index < 3000; ++index)
+		size += (size_t)sprintf(text + size, "\xC3\xA9");
+
+	size += (size_t)sprintf(text + size, "\", \"t\": [");
+
+	for (index = 0; index < 1000; ++index)
+		size += (size_t)sprintf(text + size, "{\"k\": [true]}, ");
+
+	size += (size_t)sprintf(text + size, "null], \"n\": 5}");
+
+	reader = QxJsonReader_newUtf8(text, size);
+	expect_not_null(reader);
+	expect_int_equal(QxJsonReader_next(reader), QxJsonEventBeginObject);
+	expect_int_equal(QxJsonReader_next(reader), QxJsonEventKey);
+	expect_int_equal(QxJsonReader_next(reader), QxJsonEventBeginArray);
+	expect_zero(QxJsonReader_skip(reader));
+	expect_int_equal(QxJsonReader_next(reader), QxJsonEventKey);
+	expect_wstr_equal(QxJsonReader_string(reader, NULL), L"s");
+	expect_int_equal(QxJsonReader_next(reader), QxJsonEventString);
+	string = QxJsonReader_string(reader, &size);
+	expect_int_equal(size, 3000);
+	expect_ok(string[0] == 0xE9 && string[2999] == 0xE9 && string[3000] == 0);
+	expect_int_equal(QxJsonReader_next(reader), QxJsonEventKey);
+	expect_zero(QxJsonReader_skip(reader));
+	expect_int_equal(QxJsonReader_next(reader), QxJsonEventKey);
+	expect_wstr_equal(QxJsonReader_string(reader, NULL), L"n");
+	expect_int_equal(QxJsonReader_next(reader), QxJsonEventNumber);
+	expect_double_equal(QxJsonReader_number(reader), 5);
+	expect_int_equal(QxJsonReader_next(reader), QxJsonEventEndObject);
+	expect_int_equal(QxJsonReader_next(reader), QxJsonEventEnd);
+	QxJsonReader_release(reader);
+	free(text);
+}
+
+static void testErrors(void)
+{
+	QxJsonReader *reader;
+
+	reader = QxJsonReader_new(L"[1, }", 5);
+	expect_not_null(reader);
+	expect_int_equal(QxJsonReader_next(reader), QxJsonEventBeginArray);
+	expect_int_equal(QxJsonReader_next(reader), QxJsonEventNumber);
+	expect_int_equal(QxJsonReader_next(reader), QxJsonEventError);
+	expect_int_equal(QxJsonReader_next(reader), QxJsonEventError);
+	QxJsonReader_release(reader);
+
+	/* Truncated document */
+	reader = QxJsonReader_new(L"{\"a\": [", 7);
+	expect_not_null(reader);
+	expect_int_equal(QxJsonReader_next(reader), QxJsonEventBeginObject);
+	expect_int_equal(QxJsonReader_next(reader), QxJsonEventKey);
+	expect_zero(QxJsonReader_skip(reader));
+	expect_int_equal(QxJsonReader_next(reader), QxJsonEventError);
+	QxJsonReader_release(reader);
+
+	/* Early release */
+	reader = QxJsonReader_new(L"[1, 2]", 6);
+	expect_not_null(reader);
+	expect_int_equal(QxJsonReader_next(reader), QxJsonEventBeginArray);
+	QxJsonReader_release(reader);
+}
+
+static void testRelease(void)
+{
+	QxJsonReader *reader;
+
+	QxJson_setAllocator(&strict);
+
+	/* Released before any event */
+	reader = QxJsonReader_new(L"[1, 2]", 6);
+	expect_not_null(reader);
+	QxJsonReader_release(reader);
+
+	/* Without any text */
+	reader = QxJsonReader_new(L"[1, true]", 9);
+	expect_not_null(reader);
+
+	while (QxJsonReader_next(reader) > QxJsonEventEnd)
+		continue;
+
+	QxJsonReader_release(reader);
+	QxJson_setAllocator(NULL);
+}
+
+int main(void)
+{
+	testEvents();
+	testRootNumber();
+	testSkip();
+	testSlices();
+	testErrors();
+	testRelease();
+	return EXIT_SUCCESS;
+}
@@ -6,11 +6,73 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <wchar.h>
 
 #include <qx.json.value.h>
 
 #include "expect.h"
 
+static void testUtf8(void)
+{
+	QxJsonValue *string;
+	wchar_t const *wide;
+	size_t size = 0;
+
+	expect_null(QxJsonValue_stringNewUtf8(NULL, 0));
+	expect_null(QxJsonValue_stringNewUtf8("\xc3", 1));
+	expect_null(QxJsonValue_stringNewUtf8("\xed\xa0\x80", 3));
+
+	string = QxJsonValue_stringNewUtf8("h\xc3\xa9llo \xf0\x9f\x98\x80", 11);
+	expect_not_null(string);
+	expect_ok(QX_JSON_IS_STRING(string));
+	expect_str_equal(QxJsonValue_stringUtf8(string, &size), "h\xc3\xa9llo \xf0\x9f\x98\x80");
+	expect_int_equal(size, 11);
+	expect_int_equal(QxJsonValue_size(string), WCHAR_MAX < 0x10FFFF ? 8 : 7);
+
+	/* Decoded once */
+	wide = QxJsonValue_stringValue(string);
+	expect_wstr_equal(wide, L"h\u00e9llo \U0001F600");
+	expect_ok(QxJsonValue_stringValue(string) == wide);
+	QxJsonValue_release(string);
+
+	string = QxJsonValue_stringNewUtf8("ASCII", 5);
+	expect_int_equal(QxJsonValue_size(string), 5);
+	expect_wstr_equal(QxJsonValue_stringValue(string), L"ASCII");
+	QxJsonValue_release(string);
+
+	/* Wide strings have no UTF-8 text */
+	string = QxJsonValue_stringNew(L"wide", 4);
+	expect_null(QxJsonValue_stringUtf8(string, NULL));
+	QxJsonValue_release(string);
+}
+
+static void testUtf8Keys(void)
+{
+	QxJsonValue *object, *utf8Key, *wideKey, *value = NULL;
+
+	object = QxJsonValue_objectNew();
+	utf8Key = QxJsonValue_stringNewUtf8("cl\xc3\xa9", 4);
+	wideKey = QxJsonValue_stringNew(L"cl\u00e9", 3);
+	expect_zero(QxJsonValue_objectSet(object, utf8Key, QxJsonValue_numberNewInt64(1)));
+
+	/* The same key, whatever its encoding */
+	expect_zero(QxJsonValue_objectGet(object, wideKey, &value));
+	expect_zero(QxJsonValue_objectGetData(object, L"cl\u00e9", 3, &value));
+	expect_zero(QxJsonValue_objectGetUtf8(object, "cl\xc3\xa9", 4, &value));
+	expect_not_zero(QxJsonValue_objectGetUtf8(object, "cle", 3, &value));
+	expect_zero(QxJsonValue_objectSet(object, wideKey, QxJsonValue_numberNewInt64(2)));
+	expect_int_equal(QxJsonValue_size(object), 1);
+	expect_zero(QxJsonValue_objectGet(object, utf8Key, &value));
+	expect_double_equal(QxJsonValue_numberValue(value), 2);
+
+	expect_zero(QxJsonValue_objectUnset(object, utf8Key));
+	expect_zero(QxJsonValue_size(object));
+
+	QxJsonValue_release(utf8Key);
+	QxJsonValue_release(wideKey);
+	QxJsonValue_release(object);
+}
+
 int main(void)
 {
 	QxJsonValue *string;
@@ -25,5 +87,8 @@ int main(void)
 	expect_zero(memcmp(QxJsonValue_stringValue(string), L"Hello", 5 * sizeof(wchar_t)));
 
 	QxJsonValue_release(string);
+
+	testUtf8();
+	testUtf8Keys();
 	return EXIT_SUCCESS;
 }
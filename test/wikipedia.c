@@ -46,7 +46,9 @@ static int checkAddress(QxJsonValue const *key, QxJsonValue *value, void *ptr)
 
 static int checkPhoneNumber(size_t index, QxJsonValue *value, void *ptr)
 {
-	QxJsonValue *key, *subvalue;
+	static QxJsonKey typeKey = QX_JSON_KEY(L"type");
+	static QxJsonKey numberKey = QX_JSON_KEY(L"number");
+	QxJsonValue *key, *subvalue, *handled;
 	(void)ptr;
 
 	expect_not_null(value);
@@ -62,6 +64,9 @@ static int checkPhoneNumber(size_t index, QxJsonValue *value, void *ptr)
 		expect_zero(QxJsonValue_objectGet(value, key, &subvalue));
 		QxJsonValue_release(key);
 		expect_not_null(subvalue);
+		handled = NULL;
+		expect_zero(QxJsonValue_objectGetKey(value, &typeKey, &handled));
+		expect_ok(handled == subvalue);
 		expect_wstr_equal(QxJsonValue_stringValue(subvalue), L"home");
 
 		key = QxJsonValue_stringNew(L"number", 6);
@@ -69,6 +74,9 @@ static int checkPhoneNumber(size_t index, QxJsonValue *value, void *ptr)
 		expect_zero(QxJsonValue_objectGet(value, key, &subvalue));
 		QxJsonValue_release(key);
 		expect_not_null(subvalue);
+		handled = NULL;
+		expect_zero(QxJsonValue_objectGetKey(value, &numberKey, &handled));
+		expect_ok(handled == subvalue);
 		expect_wstr_equal(QxJsonValue_stringValue(subvalue), L"212 555-1234");
 
 		break;
@@ -79,6 +87,9 @@ static int checkPhoneNumber(size_t index, QxJsonValue *value, void *ptr)
 		expect_zero(QxJsonValue_objectGet(value, key, &subvalue));
 		QxJsonValue_release(key);
 		expect_not_null(subvalue);
+		handled = NULL;
+		expect_zero(QxJsonValue_objectGetKey(value, &typeKey, &handled));
+		expect_ok(handled == subvalue);
 		expect_wstr_equal(QxJsonValue_stringValue(subvalue), L"fax");
 
 		key = QxJsonValue_stringNew(L"number", 6);
@@ -86,6 +97,9 @@ static int checkPhoneNumber(size_t index, QxJsonValue *value, void *ptr)
 		expect_zero(QxJsonValue_objectGet(value, key, &subvalue));
 		QxJsonValue_release(key);
 		expect_not_null(subvalue);
+		handled = NULL;
+		expect_zero(QxJsonValue_objectGetKey(value, &numberKey, &handled));
+		expect_ok(handled == subvalue);
 		expect_wstr_equal(QxJsonValue_stringValue(subvalue), L"646 555-4567");
 
 		break;
@@ -173,6 +187,7 @@ int main(void)
 
 	fclose(file);
 	expect_zero(QxJsonParser_end(parser, &value));
+	QxJsonParser_release(parser);
 
 	/* Check the value */
 	expect_ok(QX_JSON_IS_OBJECT(value));